@@ -1,29 +1,171 @@
 #include <stdlib.h> /* malloc, realloc, free, strtod, NULL */
 #include <assert.h> /* assert */
-#include <errno.h>  /* errno, ERANGE */
 #include <math.h>   /* HUGE_VAL */
-#include <string.h> /* memcpy */
+#include <string.h> /* memcpy, memmove */
+#include <limits.h> /* INT_MIN, INT_MAX */
+#include <stdint.h> /* uint32_t, uint64_t, uintptr_t */
+#ifndef ASON_NO_THREADS
+#include <pthread.h> /* pthread_create, pthread_join */
+#endif
+#ifndef ASON_NO_WRITEV
+#include <errno.h>   /* errno, EINTR */
+#include <sys/uio.h> /* writev */
+#endif
 #include "ason.h"
 
+static void* ason_std_malloc(void* user, size_t size) {
+    (void)user;
+    return malloc(size);
+}
+
+static void* ason_std_realloc(void* user, void* ptr, size_t size) {
+    (void)user;
+    return realloc(ptr, size);
+}
+
+static void ason_std_free(void* user, void* ptr) {
+    (void)user;
+    free(ptr);
+}
+
+static ason_allocator ason_global_allocator = { ason_std_malloc, ason_std_realloc, ason_std_free, NULL };
+
+#define ASON_A_MALLOC(a, size)       (a)->malloc_fn((a)->user, size)
+#define ASON_A_REALLOC(a, ptr, size) (a)->realloc_fn((a)->user, ptr, size)
+#define ASON_A_FREE(a, ptr)          (a)->free_fn((a)->user, ptr)
+
+/* heap values, and everything not tied to a document, use the global allocator */
+#define ASON_MALLOC(size)            ASON_A_MALLOC(&ason_global_allocator, size)
+#define ASON_CALLOC(count, size)     ason_calloc(&ason_global_allocator, count, size)
+#define ASON_REALLOC(ptr, size)      ASON_A_REALLOC(&ason_global_allocator, ptr, size)
+#define ASON_FREE(ptr)               ASON_A_FREE(&ason_global_allocator, ptr)
+
+static void* ason_calloc(const ason_allocator* a, size_t count, size_t size) {
+    void* p = ASON_A_MALLOC(a, count * size);
+    if (p != NULL)
+        memset(p, 0, count * size);
+    return p;
+}
+
+void ason_set_allocator(const ason_allocator* allocator) {
+    if (allocator == NULL) {
+        ason_global_allocator.malloc_fn = ason_std_malloc;
+        ason_global_allocator.realloc_fn = ason_std_realloc;
+        ason_global_allocator.free_fn = ason_std_free;
+        ason_global_allocator.user = NULL;
+    }
+    else {
+        assert(allocator->malloc_fn != NULL && allocator->realloc_fn != NULL && allocator->free_fn != NULL);
+        ason_global_allocator = *allocator;
+    }
+}
+
+const ason_allocator* ason_get_allocator(void) {
+    return &ason_global_allocator;
+}
+
 #ifndef ASON_PARSE_STACK_INIT_SIZE
 #define ASON_PARSE_STACK_INIT_SIZE 256
 #endif
 
+#ifndef ASON_ARENA_CHUNK_SIZE
+#define ASON_ARENA_CHUNK_SIZE 4096
+#endif
+
+#ifndef ASON_ARENA_MAX_CHUNK_SIZE
+#define ASON_ARENA_MAX_CHUNK_SIZE (1 << 20)
+#endif
+
+#ifndef ASON_PARSE_MAX_DEPTH
+#define ASON_PARSE_MAX_DEPTH 1024 /* deeper nesting fails with ASON_PARSE_DEPTH_EXCEEDED */
+#endif
+
+#ifndef ASON_FREE_STACK_SIZE
+#define ASON_FREE_STACK_SIZE 64 /* ason_free allocates for nesting deeper than this only */
+#endif
+
+#ifndef ASON_OBJECT_INDEX_MIN_SIZE
+#define ASON_OBJECT_INDEX_MIN_SIZE 16 /* smaller objects are searched linearly */
+#endif
+
+#ifndef ASON_NDJSON_MIN_PART
+#define ASON_NDJSON_MIN_PART (1 << 16) /* bytes per worker, smaller inputs use fewer threads */
+#endif
+
+/* ason_value.flags */
+#define ASON_F_INTEGER       0x01 /* ASON_NUMBER holds an exact int64 in u.num.i */
+#define ASON_F_BORROWED      0x02 /* string/array/object buffer or raw number text is not owned, ason_free leaves it alone */
+#define ASON_F_KEYS_BORROWED 0x04 /* object keys are not owned */
+#define ASON_F_KEYS_INTERNED 0x08 /* object keys are shared ason_key buffers */
+#define ASON_F_INLINE        0x10 /* ASON_STRING bytes are stored in the value itself */
+#define ASON_F_RAW           0x20 /* ASON_NUMBER is its text, u.s and size, in the input or owned by a copy */
+
+/*
+ * An inline string takes the first 14 bytes of the value. The last of them holds
+ * ASON_INLINE_MAX - len, which doubles as the '\0' of a full one.
+ */
+#define ASON_INLINE_MAX 13
+#define ASON_SIZE(v) ((size_t)((uint64_t)(v)->size_hi << 32 | (v)->size_lo))
+#define ASON_SET_SIZE(v, n) ((v)->size_lo = (uint32_t)(n), (v)->size_hi = (uint16_t)((uint64_t)(n) >> 32))
+#define ASON_STR(v) ((v)->flags & ASON_F_INLINE ? (char*)(v) : (v)->u.s)
+#define ASON_STR_LEN(v) ((v)->flags & ASON_F_INLINE ? \
+    (size_t)(ASON_INLINE_MAX - ((const unsigned char*)(v))[ASON_INLINE_MAX]) : ASON_SIZE(v))
+
+/* in front of an array's elements or an object's entries, both are NULL until there is room for one */
+typedef struct {
+    size_t capacity;
+    uint32_t* index; /* objects: key hash table, NULL until the first lookup needs it */
+} ason_header;
+
+#define ASON_HEADER_SIZE ASON_ARENA_ALIGN(sizeof(ason_header))
+#define ASON_ELEMENTS(v) ((v)->type == ASON_ARRAY ? (void*)(v)->u.m : (void*)(v)->u.e)
+#define ASON_HEADER(v) ((ason_header*)((char*)ASON_ELEMENTS(v) - ASON_HEADER_SIZE))
+#define ASON_OBJECT_INDEX(v) (((ason_header*)((char*)(v)->u.e - ASON_HEADER_SIZE))->index)
+
+typedef struct ason_arena_chunk ason_arena_chunk;
+
+struct ason_arena_chunk {
+    ason_arena_chunk* next;
+    size_t size;
+};
+
+/* chunked bump allocator, everything is released at once */
+typedef struct {
+    ason_arena_chunk* head; /* the chunk being bumped is always first */
+    char *cur, *end;
+    const ason_allocator* alloc; /* where chunks come from */
+} ason_arena;
+
+struct ason_document {
+    ason_value root;
+    ason_arena arena;
+    ason_allocator alloc; /* for the document, its arena and its parses */
+};
+
 typedef struct {
     const char* json;
+    const char* end;   /* one past the last input byte */
+    const char* limit; /* one past the last readable byte, beyond end for padded input */
     char* stack;
     size_t size, top;
+    ason_arena* arena; /* where values go, NULL for the heap */
+    const ason_allocator* alloc; /* for the stack and the intern table */
+    int insitu;        /* strings are decoded into the (writable) input */
+    int utf8;          /* strings must be valid UTF-8, ASON_PARSE_VALIDATE_UTF8 */
+    int raw_numbers;   /* numbers keep their text, ASON_PARSE_RAW_NUMBERS */
+    char** intern;     /* open-addressing table of shared keys, NULL unless ASON_PARSE_INTERN_KEYS */
+    size_t intern_count, intern_mask;
 } ason_context;
 
 static void* ason_context_push(ason_context* c, size_t size) {
     void* ret;
     assert(c != NULL && size > 0);
     if (c->top + size >= c->size) {
-        if (c->size == 0)
+        if (c->size < ASON_PARSE_STACK_INIT_SIZE) /* also for tiny caller buffers, 1.5x of 1 is 1 */
             c->size = ASON_PARSE_STACK_INIT_SIZE;
         while (c->top + size >= c->size)
             c->size += c->size >> 1; /* size * 1.5 */
-        c->stack = (char*)realloc(c->stack, c->size);
+        c->stack = (char*)ASON_A_REALLOC(c->alloc, c->stack, c->size);
     }
     ret = c->stack + c->top;
     c->top += size;
@@ -36,438 +178,4441 @@ static void* ason_context_pop(ason_context* c, size_t size) {
     return c->stack + c->top;
 }
 
-#define EXPECT(c, ch) do { assert(*c->json == ch); c->json++; } while (0)
+/*
+ * Scanning kernels for the parser hot loops.
+ *
+ * ason_scan_string() returns the first byte that ends a run of plain string
+ * characters: '"', '\\' or a control character, or end if there is none.
+ * ason_scan_whitespace() returns the first byte that is not JSON whitespace, or end.
+ * ason_scan_ascii() returns the first byte with the high bit set, or end.
+ * Vector kernels only issue aligned loads, which never cross a page boundary,
+ * so reading past end within the last block is safe. The kernel is picked on first
+ * use from the CPU features; define ASON_NO_SIMD to build the scalar loop only,
+ * ASON_NO_AVX2 to keep to SSE2.
+ */
 
-static void ason_parse_whitespace(ason_context* c) {
-    const char* p = c->json;
-    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
-        p++;
-    c->json = p;
-}
+/* 0: output as is, 'u': \u00XX, otherwise the char after the backslash */
+static const char ason_escape[256] = {
+#define Z16 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+    'u','u','u','u','u','u','u','u','b','t','n','u','f','r','u','u', /* 0x00 */
+    'u','u','u','u','u','u','u','u','u','u','u','u','u','u','u','u', /* 0x10 */
+      0,  0,'"',  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 0x20 */
+    Z16, Z16,                                                         /* 0x30~0x4F */
+      0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,'\\', 0,  0,  0, /* 0x50 */
+    Z16, Z16, Z16, Z16, Z16, Z16, Z16, Z16, Z16, Z16                  /* 0x60~0xFF */
+#undef Z16
+};
 
-static int ason_parse_null(ason_context* c, ason_value* v) {
-    EXPECT(c, 'n');
-    if (c->json[0] != 'u' || c->json[1] != 'l' || c->json[2] != 'l') {
-        return ASON_PARSE_INVALID_VALUE;
-    }
-    c->json += 3;
-    v->type = ASON_NULL;
-    return ASON_PARSE_OK;
+#define ISWHITESPACE(ch) ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+typedef const char* (*ason_scan_func)(const char* p, const char* end);
+
+/* one bit per byte of a 64-byte block, for the structural index */
+typedef struct {
+    uint64_t backslash, quote, op, ws;
+} ason_block;
+
+typedef void (*ason_classify_func)(const char* p, ason_block* b);
+
+#if !defined(ASON_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#define ASON_SIMD_X86
+#include <immintrin.h>
+
+#define ASON_ALIGN_DOWN(p, n) ((const char*)((uintptr_t)(p) & ~(uintptr_t)((n) - 1)))
+
+/* the aligned loads may read past the end of the input on purpose, keep the sanitizers quiet about it */
+#if defined(__SANITIZE_ADDRESS__)
+#define ASON_SCAN_FUNC __attribute__((no_sanitize_address)) static
+#elif defined(__SANITIZE_THREAD__)
+#define ASON_SCAN_FUNC __attribute__((no_sanitize_thread)) static
+#else
+#define ASON_SCAN_FUNC static
+#endif
+
+/* aligned blocks never straddle a page, so the block holding the last input byte is always safe to load */
+#define ASON_SCAN_BLOCKS(mask_func, width) \
+    const char* a = ASON_ALIGN_DOWN(p, width); \
+    unsigned mask; \
+    if (p >= end) \
+        return end; \
+    if ((mask = mask_func(a) >> (p - a)) != 0) \
+        p += __builtin_ctz(mask); \
+    else { \
+        do { \
+            if ((a += width) >= end) \
+                return end; \
+        } while ((mask = mask_func(a)) == 0); \
+        p = a + __builtin_ctz(mask); \
+    } \
+    return p < end ? p : end
+
+ASON_SCAN_FUNC unsigned ason_string_mask_sse2(const char* p) {
+    __m128i x = _mm_load_si128((const __m128i*)p);
+    __m128i stop = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))),
+        _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x)); /* x <= 0x1F */
+    return (unsigned)_mm_movemask_epi8(stop);
 }
 
-static int ason_parse_false(ason_context* c, ason_value* v) {
-    EXPECT(c, 'f');
-    if (c->json[0] != 'a' || c->json[1] != 'l' || c->json[2] != 's' || c->json[3] != 'e') {
-        return ASON_PARSE_INVALID_VALUE;
-    }
-    c->json += 4;
-    v->type = ASON_FALSE;
-    return ASON_PARSE_OK;
+ASON_SCAN_FUNC const char* ason_scan_string_sse2(const char* p, const char* end) {
+    ASON_SCAN_BLOCKS(ason_string_mask_sse2, 16);
 }
 
-static int ason_parse_true(ason_context* c, ason_value* v) {
-    EXPECT(c, 't');
-    if (c->json[0] != 'r' || c->json[1] != 'u' || c->json[2] != 'e') {
-        return ASON_PARSE_INVALID_VALUE;
-    }
-    c->json += 3;
-    v->type = ASON_TRUE;
-    return ASON_PARSE_OK;
+ASON_SCAN_FUNC unsigned ason_whitespace_mask_sse2(const char* p) {
+    __m128i x = _mm_load_si128((const __m128i*)p);
+    __m128i ws = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+        _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))));
+    return ~(unsigned)_mm_movemask_epi8(ws) & 0xFFFF;
 }
 
-#define ISDIGIT(ch) ((ch) >= '0' && (ch) <= '9')
-#define ISDIGIT1TO9(ch) ((ch) >= '1' && (ch) <= '9')
+ASON_SCAN_FUNC const char* ason_scan_whitespace_sse2(const char* p, const char* end) {
+    ASON_SCAN_BLOCKS(ason_whitespace_mask_sse2, 16);
+}
 
-static int ason_parse_number(ason_context* c, ason_value* v) {
-    const char* p = c->json;
-    if (*p == '-') p++;
-    if (*p == '0') p++;
-    else {
-        if (!ISDIGIT1TO9(*p)) return ASON_PARSE_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++);
-    }
-    if (*p == '.') {
-        p++;
-        if (!ISDIGIT(*p)) return ASON_PARSE_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++);
-    }
-    if (*p == 'e' || *p == 'E') {
-        p++;
-        if (*p == '+' || *p == '-') p++;
-        if (!ISDIGIT(*p)) return ASON_PARSE_INVALID_VALUE;
-        for (p++; ISDIGIT(*p); p++);
-    }
-    errno = 0;
-    v->u.num.d = strtod(c->json, NULL);
-    if (errno == ERANGE && (v->u.num.d == HUGE_VAL || v->u.num.d == -HUGE_VAL)) {
-        return ASON_PARSE_NUMBER_TOO_BIG;
-    }
-    c->json = p;
-    v->type = ASON_NUMBER;
-    return ASON_PARSE_OK;
+ASON_SCAN_FUNC unsigned ason_ascii_mask_sse2(const char* p) {
+    return (unsigned)_mm_movemask_epi8(_mm_load_si128((const __m128i*)p));
 }
 
-#define PUTC(c, ch) do { *(char*)ason_context_push(c, sizeof(char)) = (ch);} while(0)
-#define STRING_ERROR(ret) do { c->top = head; return ret; } while(0)
+ASON_SCAN_FUNC const char* ason_scan_ascii_sse2(const char* p, const char* end) {
+    ASON_SCAN_BLOCKS(ason_ascii_mask_sse2, 16);
+}
 
-static const char* ason_parse_hex4(const char* p, unsigned* u) {
-    int i;
-    *u = 0;
-    for (i=0; i<4; i++) {
-        char ch = *p++;
-        *u <<= 4;
-        if      (ch >= '0' && ch <= '9') *u |= ch - '0';
-        else if (ch >= 'a' && ch <= 'f') *u |= ch - 'a' + 10;
-        else if (ch >= 'A' && ch <= 'F') *u |= ch - 'A' + 10;
-        else return NULL;
-    }
-    return p;
+#ifndef ASON_NO_AVX2
+__attribute__((target("avx2")))
+ASON_SCAN_FUNC unsigned ason_string_mask_avx2(const char* p) {
+    __m256i x = _mm256_load_si256((const __m256i*)p);
+    __m256i stop = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x1F)), x));
+    return (unsigned)_mm256_movemask_epi8(stop);
 }
 
-static void ason_encode_utf8(ason_context* c, unsigned u) {
-    if (u <= 0x7F)
-        PUTC(c, u & 0xFF);
-    else if (u <= 0x7FF) {
-        PUTC(c, 0xC0 | ((u >>  6) & 0xFF));
-        PUTC(c, 0x80 | ( u        & 0x3F));
-    }
-    else if (u <= 0xFFFF) {
-        PUTC(c, 0xE0 | ((u >> 12) & 0xFF));
-        PUTC(c, 0x80 | ((u >>  6) & 0x3F));
-        PUTC(c, 0x80 | ( u        & 0x3F));
-    }
-    else {
-        assert(u <= 0x10FFFF);
-        PUTC(c, 0xF0 | ((u >> 18) & 0xFF));
-        PUTC(c, 0x80 | ((u >> 12) & 0x3F));
-        PUTC(c, 0x80 | ((u >>  6) & 0x3F));
-        PUTC(c, 0x80 | ( u        & 0x3F));
-    }
+__attribute__((target("avx2")))
+ASON_SCAN_FUNC const char* ason_scan_string_avx2(const char* p, const char* end) {
+    ASON_SCAN_BLOCKS(ason_string_mask_avx2, 32);
 }
 
-static int _ason_parse_string(ason_context* c, ason_string* s) {
-    size_t head = c->top, len;
-    unsigned u,ul;
-    EXPECT(c, '"');
-    const char *p = c->json;
-    while (1) {
-        char ch = *p++;
-        switch (ch) {
-            case '"':
-                len = c->top - head;
-                ason_new_string(s, (char*)ason_context_pop(c, len), len);
-                c->json = p;
-                return ASON_PARSE_OK;
-            case '\\':
-                /* parse unicode */
-                switch (*p++) {
-                    case '\\': PUTC(c, '\\'); break;
-                    case '"' : PUTC(c, '"' ); break;
-                    case '/' : PUTC(c, '/' ); break;
-                    case 'b' : PUTC(c, '\b'); break;
-                    case 'f' : PUTC(c, '\f'); break;
-                    case 'n' : PUTC(c, '\n'); break;
-                    case 'r' : PUTC(c, '\r'); break;
-                    case 't' : PUTC(c, '\t'); break;
-                    case 'u' :
-                        if (!(p = ason_parse_hex4(p, &u)))
-                            STRING_ERROR(ASON_PARSE_INVALID_UNICODE_HEX);
-                        if (u >= 0xDC00 && u <= 0xDFFF)
-                            STRING_ERROR(ASON_PARSE_INVALID_UNICODE_SURROGATE);
-                        /* surrogate pair */
-                        if (u >= 0xD800 && u <= 0xDBFF) {
-                            if (*p != '\\' || *(p+1) != 'u')
-                                STRING_ERROR(ASON_PARSE_INVALID_UNICODE_SURROGATE);
-                            p+=2;
-                            if (!(p = ason_parse_hex4(p, &ul)))
-                                STRING_ERROR(ASON_PARSE_INVALID_UNICODE_HEX);
-                            if (ul < 0xDC00 || ul > 0xDFFF)
-                                STRING_ERROR(ASON_PARSE_INVALID_UNICODE_SURROGATE);
-                            u = (((u - 0xD800) << 10) | (ul - 0xDC00)) + 0x10000;
-                        }
-                        ason_encode_utf8(c, u);
-                        break;
-                    default:
-                        STRING_ERROR(ASON_PARSE_INVALID_STRING_ESCAPE);
-                }
-                break;
-            case '\0':
-                STRING_ERROR(ASON_PARSE_MISS_QUOTATION_MARK);
-            default:
-                if ((unsigned char)ch < 0x20)
-                    STRING_ERROR(ASON_PARSE_INVALID_STRING_CHAR);
-                PUTC(c, ch);
-        }
-    }
+__attribute__((target("avx2")))
+ASON_SCAN_FUNC unsigned ason_whitespace_mask_avx2(const char* p) {
+    __m256i x = _mm256_load_si256((const __m256i*)p);
+    __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r'))));
+    return ~(unsigned)_mm256_movemask_epi8(ws);
 }
 
-static int ason_parse_string(ason_context* c, ason_value* v) {
-    int ret;
-    if ((ret = _ason_parse_string(c, &v->u.str)) == ASON_PARSE_OK)
-        v->type = ASON_STRING;
-    return ret;
+__attribute__((target("avx2")))
+ASON_SCAN_FUNC const char* ason_scan_whitespace_avx2(const char* p, const char* end) {
+    ASON_SCAN_BLOCKS(ason_whitespace_mask_avx2, 32);
 }
 
-static int ason_parse_value(ason_context* c, ason_value* v);
+__attribute__((target("avx2")))
+ASON_SCAN_FUNC unsigned ason_ascii_mask_avx2(const char* p) {
+    return (unsigned)_mm256_movemask_epi8(_mm256_load_si256((const __m256i*)p));
+}
 
-static void _ason_free_value(ason_value* m, size_t size) {
-    size_t i = 0;
-    for (i = 0; i < size; i++)
-        ason_free(&m[i]);
+__attribute__((target("avx2")))
+ASON_SCAN_FUNC const char* ason_scan_ascii_avx2(const char* p, const char* end) {
+    ASON_SCAN_BLOCKS(ason_ascii_mask_avx2, 32);
 }
+#endif
 
-static int ason_parse_array(ason_context* c, ason_value* v) {
-    int ret;
-    size_t size = 0;
-    EXPECT(c, '[');
-    ason_parse_whitespace(c);
-    if (*c->json == ']') {
-        c->json++;
-        v->type = ASON_ARRAY;
-        v->u.arr.size = size;
-        return ASON_PARSE_OK;
-    }
-    ason_value m;
-    while (1) {
-        /* parse member */
-        ason_init(&m);
-        if ((ret = ason_parse_value(c, &m)) != ASON_PARSE_OK) {
-            _ason_free_value((ason_value*)ason_context_pop(c, size * sizeof(ason_value)), size);
-            return ret;
-        }
-        memcpy(ason_context_push(c, sizeof(ason_value)), &m, sizeof(ason_value));
-        size++;
-        /* parse comma or bracket */
-        ason_parse_whitespace(c);
-        if (*c->json == ',') {
-            c->json++;
-            ason_parse_whitespace(c);
-        }
-        else if (*c->json == ']') {
-            c->json++;
-            v->type = ASON_ARRAY;
-            v->u.arr.size = size;
-            size *= sizeof(ason_value);
-            memcpy(v->u.arr.m = (ason_value*)malloc(size), ason_context_pop(c, size), size);
-            return ASON_PARSE_OK;
-        }
-        else {
-            _ason_free_value((ason_value*)ason_context_pop(c, size * sizeof(ason_value)), size);
-            return ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-        }
+/* '[' and ']' differ from '{' and '}' only in bit 0x20 */
+#define ASON_CLASSIFY_BLOCK(width, vec, loadu, or, eq, set1, movemask) \
+    int k; \
+    b->backslash = b->quote = b->op = b->ws = 0; \
+    for (k = 0; k < 64; k += width) { \
+        vec x = loadu((const vec*)(p + k)); \
+        vec folded = or(x, set1(0x20)); \
+        b->backslash |= (uint64_t)(uint32_t)movemask(eq(x, set1('\\'))) << k; \
+        b->quote |= (uint64_t)(uint32_t)movemask(eq(x, set1('"'))) << k; \
+        b->op |= (uint64_t)(uint32_t)movemask(or(or(eq(folded, set1('{')), eq(folded, set1('}'))), \
+            or(eq(x, set1(':')), eq(x, set1(','))))) << k; \
+        b->ws |= (uint64_t)(uint32_t)movemask(or(or(eq(x, set1(' ')), eq(x, set1('\t'))), \
+            or(eq(x, set1('\n')), eq(x, set1('\r'))))) << k; \
     }
+
+static void ason_classify_sse2(const char* p, ason_block* b) {
+    ASON_CLASSIFY_BLOCK(16, __m128i, _mm_loadu_si128, _mm_or_si128, _mm_cmpeq_epi8, _mm_set1_epi8, _mm_movemask_epi8)
 }
 
-static void _ason_free_entry(ason_entry* e, size_t size) {
-    size_t i = 0;
-    for (i = 0; i < size; i++)
-        free(e[i].k.s);
+#ifndef ASON_NO_AVX2
+__attribute__((target("avx2")))
+static void ason_classify_avx2(const char* p, ason_block* b) {
+    ASON_CLASSIFY_BLOCK(32, __m256i, _mm256_loadu_si256, _mm256_or_si256, _mm256_cmpeq_epi8, _mm256_set1_epi8, _mm256_movemask_epi8)
+}
+#endif
+#else
+static const char* ason_scan_string_scalar(const char* p, const char* end) {
+    while (p != end && !ason_escape[(unsigned char)*p])
+        p++;
+    return p;
 }
 
-static int ason_parse_object(ason_context* c, ason_value* v) {
-    int ret;
-    size_t size = 0;
-    EXPECT(c, '{');
-    ason_parse_whitespace(c);
-    if (*c->json == '}') {
-        c->json++;
-        v->type = ASON_OBJECT;
-        v->u.obj.e = NULL;
-        v->u.obj.size = size;
-        return ASON_PARSE_OK;
-    }
-    ason_entry e;
-    while (1) {
-        /* parse key */
-        if (*c->json != '"' || _ason_parse_string(c, &e.k) != ASON_PARSE_OK) {
-            _ason_free_entry((ason_entry*)ason_context_pop(c, size * sizeof(ason_entry)), size);
-            return ASON_PARSE_MISS_KEY;
-        }
-        /* parse colon */
-        ason_parse_whitespace(c);
-        if (*c->json == ':') {
-            c->json++;
-            ason_parse_whitespace(c);
-        }
-        else {
-            free(e.k.s);
-            _ason_free_entry((ason_entry*)ason_context_pop(c, size * sizeof(ason_entry)), size);
-            return ASON_PARSE_MISS_COLON;
-        }
-        /* parse value */
-        ason_init(&e.v);
-        if ((ret = ason_parse_value(c, &e.v)) != ASON_PARSE_OK) {
-            free(e.k.s);
-            _ason_free_entry((ason_entry*)ason_context_pop(c, size * sizeof(ason_entry)), size);
-            return ret;
-        }
-        memcpy(ason_context_push(c, sizeof(ason_entry)), &e, sizeof(ason_entry));
-        size++;
-        /* parse comma or bracket */
-        ason_parse_whitespace(c);
-        if (*c->json == ',') {
-            c->json++;
-            ason_parse_whitespace(c);
-        }
-        else if (*c->json == '}') {
-            c->json++;
-            v->type = ASON_OBJECT;
-            v->u.obj.size = size;
-            size *= sizeof(ason_entry);
-            memcpy(v->u.obj.e = (ason_entry*)malloc(size), ason_context_pop(c, size), size);
-            return ASON_PARSE_OK;
-        }
-        else {
-            _ason_free_entry((ason_entry*)ason_context_pop(c, size * sizeof(ason_entry)), size);
-            return ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
-        }
-    }
+static const char* ason_scan_whitespace_scalar(const char* p, const char* end) {
+    while (p != end && ISWHITESPACE(*p))
+        p++;
+    return p;
 }
 
-static int ason_parse_value(ason_context* c, ason_value* v) {
-    switch (*c->json) {
-        case 'n' : return ason_parse_null(c, v);
-        case 'f' : return ason_parse_false(c, v);
-        case 't' : return ason_parse_true(c, v);
-        default  : return ason_parse_number(c, v);
-        case '"' : return ason_parse_string(c, v);
-        case '[' : return ason_parse_array(c, v);
-        case '{' : return ason_parse_object(c, v);
-        case '\0': return ASON_PARSE_EXPECT_VALUE;
-    }
+static const char* ason_scan_ascii_scalar(const char* p, const char* end) {
+    while (p != end && (unsigned char)*p < 0x80)
+        p++;
+    return p;
 }
 
-int ason_parse(ason_value* v, const char* json) {
-    ason_context c;
-    int ret;
-    c.json = json;
-    c.stack = NULL;
-    c.size = c.top = 0;
-    assert(v != NULL);
-    ason_init(v);
-    ason_parse_whitespace(&c);
-    if ((ret = ason_parse_value(&c, v)) == ASON_PARSE_OK) {
-        ason_parse_whitespace(&c);
-        if (*c.json != '\0') {
-            v->type = ASON_NULL;
-            ret = ASON_PARSE_ROOT_NOT_SINGULAR;
+static void ason_classify_scalar(const char* p, ason_block* b) {
+    uint64_t bit;
+    int k;
+    b->backslash = b->quote = b->op = b->ws = 0;
+    for (k = 0; k < 64; k++) {
+        bit = (uint64_t)1 << k;
+        switch (p[k]) {
+            case '\\': b->backslash |= bit; break;
+            case '"' : b->quote |= bit; break;
+            case '{' : case '}' : case '[' : case ']' : case ':' : case ',':
+                b->op |= bit;
+                break;
+            case ' ' : case '\t': case '\n': case '\r':
+                b->ws |= bit;
+                break;
         }
     }
-    assert(c.top == 0);
-    free(c.stack);
-    return ret;
 }
+#endif /* ASON_SIMD_X86 */
 
-void ason_free(ason_value* v) {
-    size_t i;
-    assert(v != NULL);
-    switch (v->type) {
-        case ASON_STRING:
-            free(v->u.str.s);
-            break;
-        case ASON_ARRAY:
-            for (i = 0; i < v->u.arr.size; i++)
-                ason_free(&v->u.arr.m[i]);
-            if (v->u.arr.size > 0)
-                free(v->u.arr.m);
-            break;
-        case ASON_OBJECT:
-            for (i = 0; i < v->u.obj.size; i++) {
-                ason_free(&v->u.obj.e[i].v);
-                free(v->u.obj.e[i].k.s);
-            }
-            if (v->u.obj.size > 0)
-                free(v->u.obj.e);
-            break;
-        default:
-            break;
+static const char* ason_scan_string_init(const char* p, const char* end);
+static const char* ason_scan_whitespace_init(const char* p, const char* end);
+static const char* ason_scan_ascii_init(const char* p, const char* end);
+static void ason_classify_init(const char* p, ason_block* b);
+static ason_scan_func ason_scan_string = ason_scan_string_init;
+static ason_scan_func ason_scan_whitespace = ason_scan_whitespace_init;
+static ason_scan_func ason_scan_ascii = ason_scan_ascii_init;
+static ason_classify_func ason_classify = ason_classify_init;
+
+static void ason_scan_select(void) {
+#ifdef ASON_SIMD_X86
+#ifndef ASON_NO_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        ason_scan_whitespace = ason_scan_whitespace_avx2;
+        ason_scan_string = ason_scan_string_avx2;
+        ason_scan_ascii = ason_scan_ascii_avx2;
+        ason_classify = ason_classify_avx2;
+        return;
     }
-    v->type = ASON_NULL;
+#endif
+    ason_scan_whitespace = ason_scan_whitespace_sse2;
+    ason_scan_string = ason_scan_string_sse2;
+    ason_scan_ascii = ason_scan_ascii_sse2;
+    ason_classify = ason_classify_sse2;
+#else
+    ason_scan_whitespace = ason_scan_whitespace_scalar;
+    ason_scan_string = ason_scan_string_scalar;
+    ason_scan_ascii = ason_scan_ascii_scalar;
+    ason_classify = ason_classify_scalar;
+#endif
 }
 
-ason_type ason_get_type(const ason_value* v) {
-    assert(v != NULL);
-    return v->type;
+static const char* ason_scan_string_init(const char* p, const char* end) {
+    ason_scan_select();
+    return ason_scan_string(p, end);
 }
 
-int ason_get_boolean(const ason_value* v) {
-    assert(v != NULL && (v->type == ASON_TRUE || v->type == ASON_FALSE));
-    return v->type == ASON_TRUE ? 1 : 0;
+static const char* ason_scan_whitespace_init(const char* p, const char* end) {
+    ason_scan_select();
+    return ason_scan_whitespace(p, end);
 }
 
-void ason_set_boolean(ason_value* v, int b) {
-    assert(v != NULL);
-    ason_free(v);
-    v->type = b ? ASON_TRUE : ASON_FALSE;
+static const char* ason_scan_ascii_init(const char* p, const char* end) {
+    ason_scan_select();
+    return ason_scan_ascii(p, end);
 }
 
-double ason_get_number(const ason_value* v) {
-    assert(v != NULL && v->type == ASON_NUMBER);
-    return v->u.num.d;
+static void ason_classify_init(const char* p, ason_block* b) {
+    ason_scan_select();
+    ason_classify(p, b);
 }
 
-void ason_set_number(ason_value* v, double n) {
-    assert(v != NULL);
-    ason_free(v);
-    v->u.num.d = n;
-    v->type = ASON_NUMBER;
+/* well-formed UTF-8 (RFC 3629): no overlongs, surrogates or code points past U+10FFFF */
+static int ason_utf8_valid(const char* s, const char* end) {
+    const unsigned char *p = (const unsigned char*)s, *e = (const unsigned char*)end;
+    for (;;) {
+        /* ASCII runs go to the kernel, sequences are checked one at a time */
+        if ((p = (const unsigned char*)ason_scan_ascii((const char*)p, end)) == e)
+            return 1;
+        do {
+            if (*p >= 0xC2 && *p <= 0xDF) {
+                if (e - p < 2 || (p[1] & 0xC0) != 0x80)
+                    return 0;
+                p += 2;
+            }
+            else if (*p >= 0xE0 && *p <= 0xEF) {
+                if (e - p < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 ||
+                    (*p == 0xE0 && p[1] < 0xA0) || (*p == 0xED && p[1] > 0x9F))
+                    return 0;
+                p += 3;
+            }
+            else if (*p >= 0xF0 && *p <= 0xF4) {
+                if (e - p < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80 ||
+                    (*p == 0xF0 && p[1] < 0x90) || (*p == 0xF4 && p[1] > 0x8F))
+                    return 0;
+                p += 4;
+            }
+            else
+                return 0;
+        } while (p != e && *p >= 0x80);
+    }
 }
 
-const char* ason_get_string(const ason_value* v) {
-    assert(v != NULL && v->type == ASON_STRING);
-    return v->u.str.s;
-}
+#define ASON_ARENA_ALIGN(n) (((n) + 7) & ~(size_t)7)
+#define ASON_ARENA_HEADER ASON_ARENA_ALIGN(sizeof(ason_arena_chunk))
 
-size_t ason_get_string_length(const ason_value* v) {
-    assert(v != NULL && v->type == ASON_STRING);
-    return v->u.str.len;
+static void ason_arena_init(ason_arena* a, const ason_allocator* alloc) {
+    a->head = NULL;
+    a->cur = a->end = NULL;
+    a->alloc = alloc;
 }
 
-void ason_new_string(ason_string* str, const char* s, size_t len) {
-    assert(str != NULL && (s != NULL || len == 0));
-    str->s = (char*)malloc(len+1);
-    memcpy(str->s, s, len);
-    str->s[len] = '\0';
-    str->len = len;
+static void* ason_arena_alloc(ason_arena* a, size_t size) {
+    ason_arena_chunk* chunk;
+    size_t chunk_size;
+    void* ret;
+    size = ASON_ARENA_ALIGN(size);
+    if ((size_t)(a->end - a->cur) >= size) {
+        ret = a->cur;
+        a->cur += size;
+        return ret;
+    }
+    chunk_size = a->head ? a->head->size * 2 : ASON_ARENA_CHUNK_SIZE;
+    if (chunk_size > ASON_ARENA_MAX_CHUNK_SIZE)
+        chunk_size = ASON_ARENA_MAX_CHUNK_SIZE;
+    if (a->head && size > chunk_size / 4) {
+        /* large block: own chunk behind the head so the current one keeps bumping */
+        chunk = (ason_arena_chunk*)ASON_A_MALLOC(a->alloc, ASON_ARENA_HEADER + size);
+        chunk->size = size;
+        chunk->next = a->head->next;
+        a->head->next = chunk;
+        return (char*)chunk + ASON_ARENA_HEADER;
+    }
+    if (chunk_size < size)
+        chunk_size = size;
+    chunk = (ason_arena_chunk*)ASON_A_MALLOC(a->alloc, ASON_ARENA_HEADER + chunk_size);
+    chunk->size = chunk_size;
+    chunk->next = a->head;
+    a->head = chunk;
+    a->cur = (char*)chunk + ASON_ARENA_HEADER + size;
+    a->end = (char*)chunk + ASON_ARENA_HEADER + chunk_size;
+    return (char*)chunk + ASON_ARENA_HEADER;
+}
+
+/* keeps the current chunk for the next use, frees the rest */
+static void ason_arena_reset(ason_arena* a) {
+    ason_arena_chunk *chunk, *next;
+    if (a->head == NULL)
+        return;
+    for (chunk = a->head->next; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        ASON_A_FREE(a->alloc, chunk);
+    }
+    a->head->next = NULL;
+    a->cur = (char*)a->head + ASON_ARENA_HEADER;
+}
+
+static void ason_arena_release(ason_arena* a) {
+    ason_arena_reset(a);
+    ASON_A_FREE(a->alloc, a->head);
+    ason_arena_init(a, a->alloc);
+}
+
+static void* ason_context_alloc(ason_context* c, size_t size) {
+    return c->arena ? ason_arena_alloc(c->arena, size) : ASON_MALLOC(size);
+}
+
+static void ason_context_free_string(ason_context* c, char* s) {
+    if (!c->arena && !c->insitu)
+        ASON_FREE(s);
+}
+
+static void ason_context_new_string(ason_context* c, ason_string* str, const char* s, size_t len) {
+    str->s = (char*)ason_context_alloc(c, len + 1);
+    memcpy(str->s, s, len);
+    str->s[len] = '\0';
+    str->len = len;
+}
+
+/* makes v a string of len bytes, the caller writes them and the '\0' to the returned buffer */
+static char* ason_value_new_string(ason_value* v, size_t len, ason_arena* arena) {
+    char* s;
+    v->type = ASON_STRING;
+    if (len <= ASON_INLINE_MAX) {
+        v->flags = ASON_F_INLINE;
+        s = (char*)v;
+        s[ASON_INLINE_MAX] = (char)(ASON_INLINE_MAX - len);
+        return s;
+    }
+    v->flags = arena ? ASON_F_BORROWED : 0;
+    v->u.s = s = (char*)(arena ? ason_arena_alloc(arena, len + 1) : ASON_MALLOC(len + 1));
+    ASON_SET_SIZE(v, len);
+    return s;
+}
+
+/* room for count elements of elem bytes behind a header */
+static void* ason_context_alloc_elements(ason_context* c, size_t count, size_t elem) {
+    ason_header* h = (ason_header*)ason_context_alloc(c, ASON_HEADER_SIZE + count * elem);
+    h->capacity = count;
+    h->index = NULL;
+    return (char*)h + ASON_HEADER_SIZE;
+}
+
+static void ason_value_set_string(ason_value* v, const char* s, size_t len, ason_arena* arena) {
+    char* p = ason_value_new_string(v, len, arena);
+    memcpy(p, s, len);
+    p[len] = '\0';
+}
+
+/* header in front of an interned key's bytes */
+typedef struct {
+    size_t refs; /* owners, including the parse's table; unused in an arena */
+    size_t len;
+    uint32_t hash;
+} ason_key;
+
+#define ASON_KEY_HEADER ASON_ARENA_ALIGN(sizeof(ason_key))
+#define ASON_KEY_OF(s) ((ason_key*)((char*)(s) - ASON_KEY_HEADER))
+
+static uint32_t ason_hash_key(const char* s, size_t len) {
+    uint32_t h = 2166136261u; /* FNV-1a */
+    while (len--)
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+static void ason_key_retain(char* s) {
+#ifndef ASON_NO_THREADS
+    __sync_add_and_fetch(&ASON_KEY_OF(s)->refs, 1);
+#else
+    ASON_KEY_OF(s)->refs++;
+#endif
+}
+
+static void ason_key_release(char* s) {
+    ason_key* k = ASON_KEY_OF(s);
+#ifndef ASON_NO_THREADS
+    if (__sync_sub_and_fetch(&k->refs, 1) == 0)
+#else
+    if (--k->refs == 0)
+#endif
+        ASON_FREE(k);
+}
+
+static void ason_context_intern_grow(ason_context* c) {
+    char** old = c->intern;
+    size_t i, j, mask = c->intern_mask;
+    c->intern_mask = mask * 2 + 1;
+    c->intern = (char**)ason_calloc(c->alloc, c->intern_mask + 1, sizeof(char*));
+    for (i = 0; i <= mask; i++)
+        if (old[i] != NULL) {
+            for (j = ASON_KEY_OF(old[i])->hash & c->intern_mask; c->intern[j] != NULL; j = (j + 1) & c->intern_mask)
+                ;
+            c->intern[j] = old[i];
+        }
+    ASON_A_FREE(c->alloc, old);
+}
+
+/* the shared copy of s, one more reference to it for the caller */
+static char* ason_context_intern(ason_context* c, const char* s, size_t len) {
+    uint32_t hash = ason_hash_key(s, len);
+    ason_key* k;
+    char* p;
+    size_t i;
+    for (i = hash & c->intern_mask; (p = c->intern[i]) != NULL; i = (i + 1) & c->intern_mask) {
+        k = ASON_KEY_OF(p);
+        if (k->hash == hash && k->len == len && memcmp(p, s, len) == 0) {
+            k->refs++;
+            return p;
+        }
+    }
+    k = (ason_key*)ason_context_alloc(c, ASON_KEY_HEADER + len + 1);
+    k->refs = 2;
+    k->len = len;
+    k->hash = hash;
+    p = (char*)k + ASON_KEY_HEADER;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    c->intern[i] = p;
+    if (++c->intern_count * 2 > c->intern_mask)
+        ason_context_intern_grow(c);
+    return p;
+}
+
+static void ason_context_free_key(ason_context* c, char* s) {
+    if (c->intern == NULL)
+        ason_context_free_string(c, s);
+    else if (!c->arena)
+        ason_key_release(s);
+}
+
+static void ason_context_init_alloc(ason_context* c, const char* json, size_t len, unsigned flags, const ason_allocator* alloc) {
+    c->json = json;
+    c->end = json + len;
+    c->limit = c->end + (flags & ASON_PARSE_PADDED ? ASON_PADDING : 0);
+    c->stack = NULL;
+    c->size = c->top = 0;
+    c->arena = NULL;
+    c->alloc = alloc;
+    c->insitu = 0;
+    c->utf8 = (flags & ASON_PARSE_VALIDATE_UTF8) != 0;
+    c->raw_numbers = (flags & ASON_PARSE_RAW_NUMBERS) != 0;
+    c->intern = NULL;
+    c->intern_count = c->intern_mask = 0;
+    if (flags & ASON_PARSE_INTERN_KEYS) {
+        c->intern_mask = 63;
+        c->intern = (char**)ason_calloc(alloc, c->intern_mask + 1, sizeof(char*));
+    }
+}
+
+static void ason_context_init(ason_context* c, const char* json, size_t len, unsigned flags) {
+    ason_context_init_alloc(c, json, len, flags, &ason_global_allocator);
+}
+
+/* frees the stack and drops the intern table's references */
+static void ason_context_release(ason_context* c) {
+    size_t i;
+    ASON_A_FREE(c->alloc, c->stack);
+    if (c->intern != NULL) {
+        if (!c->arena)
+            for (i = 0; i <= c->intern_mask; i++)
+                if (c->intern[i] != NULL)
+                    ason_key_release(c->intern[i]);
+        ASON_A_FREE(c->alloc, c->intern);
+    }
+}
+
+#define EXPECT(c, ch) do { assert(*c->json == ch); c->json++; } while (0)
+/* the next input byte, '\0' at the end */
+#define PEEK(c) ((c)->json != (c)->end ? *(c)->json : '\0')
+
+static void ason_parse_whitespace(ason_context* c) {
+    const char *p = c->json, *end = c->end;
+    /* most tokens are followed by no or a single space, leave long runs to the kernel */
+    if (p != end && ISWHITESPACE(*p)) {
+        p++;
+        if (p != end && ISWHITESPACE(*p))
+            p = ason_scan_whitespace(p, end);
+    }
+    c->json = p;
+}
+
+static int ason_parse_literal(ason_context* c, ason_value* v, const char* literal, size_t n, ason_type type) {
+    if ((size_t)(c->end - c->json) < n || memcmp(c->json, literal, n) != 0)
+        return ASON_PARSE_INVALID_VALUE;
+    c->json += n;
+    v->type = type;
+    return ASON_PARSE_OK;
+}
+
+/* DiyFp: 64-bit significand and binary exponent, shared by number parsing and dtoa */
+
+#define ASON_UINT64_C2(high32, low32) (((uint64_t)(high32) << 32) | (uint64_t)(low32))
+#define ASON_DP_SIGNIFICAND_SIZE 52
+#define ASON_DP_EXPONENT_BIAS    (0x3FF + ASON_DP_SIGNIFICAND_SIZE)
+#define ASON_DP_MIN_EXPONENT     (-ASON_DP_EXPONENT_BIAS)
+#define ASON_DP_EXPONENT_MASK    ASON_UINT64_C2(0x7FF00000, 0x00000000)
+#define ASON_DP_SIGNIFICAND_MASK ASON_UINT64_C2(0x000FFFFF, 0xFFFFFFFF)
+#define ASON_DP_HIDDEN_BIT       ASON_UINT64_C2(0x00100000, 0x00000000)
+
+typedef struct {
+    uint64_t f;
+    int e;
+} ason_diyfp;
+
+static ason_diyfp ason_diyfp_make(uint64_t f, int e) {
+    ason_diyfp r;
+    r.f = f;
+    r.e = e;
+    return r;
+}
+
+static ason_diyfp ason_diyfp_from_double(double d) {
+    union { double d; uint64_t u; } u;
+    int biased_e;
+    uint64_t significand;
+    u.d = d;
+    biased_e = (int)((u.u & ASON_DP_EXPONENT_MASK) >> ASON_DP_SIGNIFICAND_SIZE);
+    significand = u.u & ASON_DP_SIGNIFICAND_MASK;
+    if (biased_e != 0)
+        return ason_diyfp_make(significand + ASON_DP_HIDDEN_BIT, biased_e - ASON_DP_EXPONENT_BIAS);
+    return ason_diyfp_make(significand, ASON_DP_MIN_EXPONENT + 1);
+}
+
+static ason_diyfp ason_diyfp_mul(ason_diyfp x, ason_diyfp y) {
+    const uint64_t M32 = 0xFFFFFFFF;
+    uint64_t a = x.f >> 32, b = x.f & M32, c = y.f >> 32, d = y.f & M32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += 1U << 31; /* round */
+    return ason_diyfp_make(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+static ason_diyfp ason_diyfp_normalize(ason_diyfp x) {
+#if defined(__GNUC__)
+    int s = __builtin_clzll(x.f);
+    x.f <<= s;
+    x.e -= s;
+#else
+    while (!(x.f & ASON_UINT64_C2(0x80000000, 0x00000000))) {
+        x.f <<= 1;
+        x.e--;
+    }
+#endif
+    return x;
+}
+
+static void ason_diyfp_boundaries(ason_diyfp v, ason_diyfp* minus, ason_diyfp* plus) {
+    ason_diyfp pl = ason_diyfp_make((v.f << 1) + 1, v.e - 1), mi;
+    while (!(pl.f & (ASON_DP_HIDDEN_BIT << 1))) {
+        pl.f <<= 1;
+        pl.e--;
+    }
+    pl.f <<= 64 - ASON_DP_SIGNIFICAND_SIZE - 2;
+    pl.e -= 64 - ASON_DP_SIGNIFICAND_SIZE - 2;
+    if (v.f == ASON_DP_HIDDEN_BIT)
+        mi = ason_diyfp_make((v.f << 2) - 1, v.e - 2);
+    else
+        mi = ason_diyfp_make((v.f << 1) - 1, v.e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *plus = pl;
+    *minus = mi;
+}
+
+/* 10^-348, 10^-340, ..., 10^340 */
+static const uint64_t ason_cached_powers_f[] = {
+    ASON_UINT64_C2(0xfa8fd5a0, 0x081c0288), ASON_UINT64_C2(0xbaaee17f, 0xa23ebf76), ASON_UINT64_C2(0x8b16fb20, 0x3055ac76),
+    ASON_UINT64_C2(0xcf42894a, 0x5dce35ea), ASON_UINT64_C2(0x9a6bb0aa, 0x55653b2d), ASON_UINT64_C2(0xe61acf03, 0x3d1a45df),
+    ASON_UINT64_C2(0xab70fe17, 0xc79ac6ca), ASON_UINT64_C2(0xff77b1fc, 0xbebcdc4f), ASON_UINT64_C2(0xbe5691ef, 0x416bd60c),
+    ASON_UINT64_C2(0x8dd01fad, 0x907ffc3c), ASON_UINT64_C2(0xd3515c28, 0x31559a83), ASON_UINT64_C2(0x9d71ac8f, 0xada6c9b5),
+    ASON_UINT64_C2(0xea9c2277, 0x23ee8bcb), ASON_UINT64_C2(0xaecc4991, 0x4078536d), ASON_UINT64_C2(0x823c1279, 0x5db6ce57),
+    ASON_UINT64_C2(0xc2109436, 0x4dfb5637), ASON_UINT64_C2(0x9096ea6f, 0x3848984f), ASON_UINT64_C2(0xd77485cb, 0x25823ac7),
+    ASON_UINT64_C2(0xa086cfcd, 0x97bf97f4), ASON_UINT64_C2(0xef340a98, 0x172aace5), ASON_UINT64_C2(0xb23867fb, 0x2a35b28e),
+    ASON_UINT64_C2(0x84c8d4df, 0xd2c63f3b), ASON_UINT64_C2(0xc5dd4427, 0x1ad3cdba), ASON_UINT64_C2(0x936b9fce, 0xbb25c996),
+    ASON_UINT64_C2(0xdbac6c24, 0x7d62a584), ASON_UINT64_C2(0xa3ab6658, 0x0d5fdaf6), ASON_UINT64_C2(0xf3e2f893, 0xdec3f126),
+    ASON_UINT64_C2(0xb5b5ada8, 0xaaff80b8), ASON_UINT64_C2(0x87625f05, 0x6c7c4a8b), ASON_UINT64_C2(0xc9bcff60, 0x34c13053),
+    ASON_UINT64_C2(0x964e858c, 0x91ba2655), ASON_UINT64_C2(0xdff97724, 0x70297ebd), ASON_UINT64_C2(0xa6dfbd9f, 0xb8e5b88f),
+    ASON_UINT64_C2(0xf8a95fcf, 0x88747d94), ASON_UINT64_C2(0xb9447093, 0x8fa89bcf), ASON_UINT64_C2(0x8a08f0f8, 0xbf0f156b),
+    ASON_UINT64_C2(0xcdb02555, 0x653131b6), ASON_UINT64_C2(0x993fe2c6, 0xd07b7fac), ASON_UINT64_C2(0xe45c10c4, 0x2a2b3b06),
+    ASON_UINT64_C2(0xaa242499, 0x697392d3), ASON_UINT64_C2(0xfd87b5f2, 0x8300ca0e), ASON_UINT64_C2(0xbce50864, 0x92111aeb),
+    ASON_UINT64_C2(0x8cbccc09, 0x6f5088cc), ASON_UINT64_C2(0xd1b71758, 0xe219652c), ASON_UINT64_C2(0x9c400000, 0x00000000),
+    ASON_UINT64_C2(0xe8d4a510, 0x00000000), ASON_UINT64_C2(0xad78ebc5, 0xac620000), ASON_UINT64_C2(0x813f3978, 0xf8940984),
+    ASON_UINT64_C2(0xc097ce7b, 0xc90715b3), ASON_UINT64_C2(0x8f7e32ce, 0x7bea5c70), ASON_UINT64_C2(0xd5d238a4, 0xabe98068),
+    ASON_UINT64_C2(0x9f4f2726, 0x179a2245), ASON_UINT64_C2(0xed63a231, 0xd4c4fb27), ASON_UINT64_C2(0xb0de6538, 0x8cc8ada8),
+    ASON_UINT64_C2(0x83c7088e, 0x1aab65db), ASON_UINT64_C2(0xc45d1df9, 0x42711d9a), ASON_UINT64_C2(0x924d692c, 0xa61be758),
+    ASON_UINT64_C2(0xda01ee64, 0x1a708dea), ASON_UINT64_C2(0xa26da399, 0x9aef774a), ASON_UINT64_C2(0xf209787b, 0xb47d6b85),
+    ASON_UINT64_C2(0xb454e4a1, 0x79dd1877), ASON_UINT64_C2(0x865b8692, 0x5b9bc5c2), ASON_UINT64_C2(0xc83553c5, 0xc8965d3d),
+    ASON_UINT64_C2(0x952ab45c, 0xfa97a0b3), ASON_UINT64_C2(0xde469fbd, 0x99a05fe3), ASON_UINT64_C2(0xa59bc234, 0xdb398c25),
+    ASON_UINT64_C2(0xf6c69a72, 0xa3989f5c), ASON_UINT64_C2(0xb7dcbf53, 0x54e9bece), ASON_UINT64_C2(0x88fcf317, 0xf22241e2),
+    ASON_UINT64_C2(0xcc20ce9b, 0xd35c78a5), ASON_UINT64_C2(0x98165af3, 0x7b2153df), ASON_UINT64_C2(0xe2a0b5dc, 0x971f303a),
+    ASON_UINT64_C2(0xa8d9d153, 0x5ce3b396), ASON_UINT64_C2(0xfb9b7cd9, 0xa4a7443c), ASON_UINT64_C2(0xbb764c4c, 0xa7a44410),
+    ASON_UINT64_C2(0x8bab8eef, 0xb6409c1a), ASON_UINT64_C2(0xd01fef10, 0xa657842c), ASON_UINT64_C2(0x9b10a4e5, 0xe9913129),
+    ASON_UINT64_C2(0xe7109bfb, 0xa19c0c9d), ASON_UINT64_C2(0xac2820d9, 0x623bf429), ASON_UINT64_C2(0x80444b5e, 0x7aa7cf85),
+    ASON_UINT64_C2(0xbf21e440, 0x03acdd2d), ASON_UINT64_C2(0x8e679c2f, 0x5e44ff8f), ASON_UINT64_C2(0xd433179d, 0x9c8cb841),
+    ASON_UINT64_C2(0x9e19db92, 0xb4e31ba9), ASON_UINT64_C2(0xeb96bf6e, 0xbadf77d9), ASON_UINT64_C2(0xaf87023b, 0x9bf0ee6b)
+};
+
+static const short ason_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+    -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369,
+    -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77,
+    -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216,
+    242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508,
+    534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800,
+    827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static ason_diyfp ason_cached_power(int e, int* K) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347; /* dk must be positive */
+    int k = (int)dk;
+    unsigned index;
+    if (dk - k > 0.0)
+        k++;
+    index = (unsigned)((k >> 3) + 1);
+    *K = -(-348 + (int)(index << 3));
+    return ason_diyfp_make(ason_cached_powers_f[index], ason_cached_powers_e[index]);
+}
+
+static const uint64_t ason_pow10[] = {
+    1U, 10U, 100U, 1000U, 10000U, 100000U, 1000000U, 10000000U, 100000000U, 1000000000U,
+    ASON_UINT64_C2(0x00000002, 0x540BE400), ASON_UINT64_C2(0x00000017, 0x4876E800),
+    ASON_UINT64_C2(0x000000E8, 0xD4A51000), ASON_UINT64_C2(0x00000918, 0x4E72A000),
+    ASON_UINT64_C2(0x00005AF3, 0x107A4000), ASON_UINT64_C2(0x00038D7E, 0xA4C68000),
+    ASON_UINT64_C2(0x002386F2, 0x6FC10000), ASON_UINT64_C2(0x01634578, 0x5D8A0000),
+    ASON_UINT64_C2(0x0DE0B6B3, 0xA7640000), ASON_UINT64_C2(0x8AC72304, 0x89E80000)
+};
+
+#define ISDIGIT(ch) ((ch) >= '0' && (ch) <= '9')
+#define ISDIGIT1TO9(ch) ((ch) >= '1' && (ch) <= '9')
+
+#define ASON_DP_DENORMAL_EXPONENT (-ASON_DP_EXPONENT_BIAS + 1)
+#define ASON_DP_MAX_EXPONENT      (0x7FF - ASON_DP_EXPONENT_BIAS)
+
+static double ason_diyfp_to_double(ason_diyfp x) {
+    union { double d; uint64_t u; } u;
+    uint64_t be;
+    if (x.e < ASON_DP_DENORMAL_EXPONENT)
+        return 0.0;
+    if (x.e >= ASON_DP_MAX_EXPONENT)
+        return HUGE_VAL;
+    be = (x.e == ASON_DP_DENORMAL_EXPONENT && (x.f & ASON_DP_HIDDEN_BIT) == 0) ? 0 :
+        (uint64_t)(x.e + ASON_DP_EXPONENT_BIAS);
+    u.u = (x.f & ASON_DP_SIGNIFICAND_MASK) | (be << ASON_DP_SIGNIFICAND_SIZE);
+    return u.d;
+}
+
+/* 10^0 ... 10^22 are exact doubles */
+static const double ason_exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * significand * 10^exp10 rounded to double with DiyFp arithmetic, tracking the error
+ * bound in 1/8 ulp. Returns 0 when the result may be off by one ulp (halfway cases),
+ * the caller then has to fall back to an exact conversion.
+ */
+static int ason_strtod_diyfp(uint64_t significand, int exp10, int digits, int inexact, double* d) {
+    static const uint64_t kPow10f[] = {
+        ASON_UINT64_C2(0xa0000000, 0x00000000), ASON_UINT64_C2(0xc8000000, 0x00000000),
+        ASON_UINT64_C2(0xfa000000, 0x00000000), ASON_UINT64_C2(0x9c400000, 0x00000000),
+        ASON_UINT64_C2(0xc3500000, 0x00000000), ASON_UINT64_C2(0xf4240000, 0x00000000),
+        ASON_UINT64_C2(0x98968000, 0x00000000)
+    };
+    static const int kPow10e[] = { -60, -57, -54, -50, -47, -44, -40 };
+    const int kUlpShift = 3, kUlp = 1 << 3;
+    uint64_t error = inexact ? kUlp / 2 : 0, precision_bits, half_way;
+    ason_diyfp v = ason_diyfp_normalize(ason_diyfp_make(significand, 0)), rounded;
+    unsigned index = (unsigned)(exp10 + 348) / 8u;
+    int adjustment = exp10 - (-348 + (int)index * 8), old_e, effective, precision;
+
+    error <<= -v.e;
+    if (adjustment > 0) {
+        v = ason_diyfp_mul(v, ason_diyfp_make(kPow10f[adjustment - 1], kPow10e[adjustment - 1]));
+        if (digits + adjustment > 19) /* more digits than a uint64 holds */
+            error += kUlp / 2;
+    }
+    v = ason_diyfp_mul(v, ason_diyfp_make(ason_cached_powers_f[index], ason_cached_powers_e[index]));
+    error += kUlp + (error == 0 ? 0 : 1);
+
+    old_e = v.e;
+    v = ason_diyfp_normalize(v);
+    error <<= old_e - v.e;
+
+    /* significand bits available at this magnitude, fewer for subnormals */
+    effective = 64 + v.e >= -1021 ? 53 : (64 + v.e <= -1074 ? 0 : 64 + v.e + 1074);
+    precision = 64 - effective;
+    if (precision + kUlpShift >= 64) {
+        int scale_exp = (precision + kUlpShift) - 63;
+        v.f >>= scale_exp;
+        v.e += scale_exp;
+        error = (error >> scale_exp) + 1 + kUlp;
+        precision -= scale_exp;
+    }
+
+    rounded = ason_diyfp_make(v.f >> precision, v.e + precision);
+    precision_bits = (v.f & (((uint64_t)1 << precision) - 1)) * kUlp;
+    half_way = ((uint64_t)1 << (precision - 1)) * kUlp;
+    if (precision_bits >= half_way + error) {
+        rounded.f++;
+        if (rounded.f & (ASON_DP_HIDDEN_BIT << 1)) { /* rounding overflows mantissa */
+            rounded.f >>= 1;
+            rounded.e++;
+        }
+    }
+    *d = ason_diyfp_to_double(rounded);
+    return half_way - error >= precision_bits || precision_bits >= half_way + error;
+}
+
+#define ASON_STRTOD_DIGITS 800 /* halfway points between doubles have at most 767 significant digits */
+
+/*
+ * Exact fallback for the rare halfway cases: hand strtod the digits without the
+ * decimal point ("12345e-3"), which reads the same under every locale. Digits past
+ * ASON_STRTOD_DIGITS only matter for being nonzero and become a final 1, so the
+ * buffer is fixed.
+ */
+static double ason_strtod_fallback(const char* p, const char* end, int exp10) {
+    char buf[ASON_STRTOD_DIGITS + 16], digits[12];
+    int n = 0, k = 0, sticky = 0;
+    for (; p < end && *p != 'e' && *p != 'E'; p++) {
+        if (!ISDIGIT(*p) || (n == 0 && *p == '0'))
+            continue;
+        if (n < ASON_STRTOD_DIGITS)
+            buf[n++] = *p;
+        else {
+            sticky |= *p != '0';
+            exp10++;
+        }
+    }
+    if (sticky) {
+        buf[n++] = '1';
+        exp10--;
+    }
+    buf[n++] = 'e';
+    if (exp10 < 0) {
+        buf[n++] = '-';
+        exp10 = -exp10;
+    }
+    do digits[k++] = (char)('0' + exp10 % 10); while (exp10 /= 10);
+    while (k > 0)
+        buf[n++] = digits[--k];
+    buf[n] = '\0';
+    return strtod(buf, NULL);
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ASON_SWAR_DIGITS
+#define ASON_BYTES(b) ((uint64_t)(b) * ASON_UINT64_C2(0x01010101, 0x01010101))
+
+/*
+ * Converts the run of up to 8 digits at p with one 8-byte load, *n gets the run length.
+ * The load may cover bytes after end, which are only read, never counted.
+ */
+static uint32_t ason_parse_digits8(const char* p, const char* end, int* n) {
+    uint64_t x, nondigit;
+    int k;
+    memcpy(&x, p, 8);
+    /* a byte is a digit when both its high nibble and that of byte + 6 are 3 */
+    nondigit = ((x & ASON_BYTES(0xF0)) ^ ASON_BYTES(0x30)) | (((x + ASON_BYTES(0x06)) & ASON_BYTES(0xF0)) ^ ASON_BYTES(0x30));
+    k = nondigit ? __builtin_ctzll(nondigit) >> 3 : 8;
+    if (k > end - p)
+        k = (int)(end - p);
+    if ((*n = k) == 0)
+        return 0;
+    /* keep the k digits in the top bytes, the zeros shifted in act as leading '0's */
+    x = (x - ASON_BYTES(0x30)) << (8 * (8 - k));
+    x = x * 10 + (x >> 8); /* pairs of digits in every other byte */
+    return (uint32_t)(((x & ASON_UINT64_C2(0x000000FF, 0x000000FF)) * ASON_UINT64_C2(1000000, 100) +
+        ((x >> 16) & ASON_UINT64_C2(0x000000FF, 0x000000FF)) * ASON_UINT64_C2(10000, 1)) >> 32);
+}
+#endif
+
+/* checks the grammar only and keeps the text, ason_number_value converts it when read */
+static int ason_parse_raw_number(ason_context* c, ason_value* v) {
+    const char *p = c->json, *end = c->end;
+    if (p != end && *p == '-') p++;
+    if (p != end && *p == '0') p++;
+    else {
+        if (p == end || !ISDIGIT1TO9(*p)) return ASON_PARSE_INVALID_VALUE;
+        for (p++; p != end && ISDIGIT(*p); p++);
+    }
+    if (p != end && *p == '.') {
+        p++;
+        if (p == end || !ISDIGIT(*p)) return ASON_PARSE_INVALID_VALUE;
+        for (p++; p != end && ISDIGIT(*p); p++);
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p != end && (*p == '+' || *p == '-')) p++;
+        if (p == end || !ISDIGIT(*p)) return ASON_PARSE_INVALID_VALUE;
+        for (p++; p != end && ISDIGIT(*p); p++);
+    }
+    v->u.s = (char*)c->json;
+    ASON_SET_SIZE(v, (size_t)(p - c->json));
+    v->type = ASON_NUMBER;
+    v->flags = ASON_F_RAW | ASON_F_BORROWED;
+    c->json = p;
+    return ASON_PARSE_OK;
+}
+
+static int ason_parse_number(ason_context* c, ason_value* v) {
+    const char *p = c->json, *end = c->end;
+    const char* digits;
+    uint64_t significand = 0;
+    int neg = 0, is_int = 1, kept = 0, dropped = 0, inexact = 0, round_up = 0;
+    int exp10 = 0, frac_digits = 0, e = 0, exp_neg = 0;
+    double d;
+#ifdef ASON_SWAR_DIGITS
+    uint32_t chunk;
+    int n;
+#endif
+
+    if (c->raw_numbers)
+        return ason_parse_raw_number(c, v);
+
+    /* validate and accumulate up to 19 significant digits in a single pass */
+#define ACCUMULATE(ch) \
+    do { \
+        if (kept < 19) { \
+            if (significand != 0 || (ch) != '0') { \
+                significand = significand * 10 + (uint64_t)((ch) - '0'); \
+                kept++; \
+            } \
+        } \
+        else { \
+            if (dropped++ == 0) round_up = (ch) >= '5'; \
+            if ((ch) != '0') inexact = 1; \
+        } \
+    } while(0)
+#ifdef ASON_SWAR_DIGITS
+    /* 8 digits at a time while they all fit in the significand, padding extends it to the end */
+#define ACCUMULATE8(frac) \
+    while (significand != 0 && kept <= 11 && c->limit - p >= 8) { \
+        chunk = ason_parse_digits8(p, end, &n); \
+        significand = significand * ason_pow10[n] + chunk; \
+        kept += n; \
+        p += n; \
+        if (frac) { \
+            exp10 -= n; \
+            frac_digits += n; \
+        } \
+        if (n < 8) \
+            break; \
+    }
+#else
+#define ACCUMULATE8(frac)
+#endif
+
+    if (p != end && *p == '-') {
+        neg = 1;
+        p++;
+    }
+    digits = p;
+    if (p != end && *p == '0') p++;
+    else {
+        if (p == end || !ISDIGIT1TO9(*p)) return ASON_PARSE_INVALID_VALUE;
+        ACCUMULATE(*p);
+        p++;
+        ACCUMULATE8(0);
+        for (; p != end && ISDIGIT(*p); p++)
+            ACCUMULATE(*p);
+        exp10 = dropped;
+    }
+    if (p != end && *p == '.') {
+        p++;
+        if (p == end || !ISDIGIT(*p)) return ASON_PARSE_INVALID_VALUE;
+        is_int = 0;
+        while (p != end && ISDIGIT(*p)) {
+            if (kept < 19) exp10--;
+            frac_digits++;
+            ACCUMULATE(*p);
+            p++;
+            ACCUMULATE8(1);
+        }
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        p++;
+        is_int = 0;
+        if (p != end && (*p == '+' || *p == '-')) exp_neg = *p++ == '-';
+        if (p == end || !ISDIGIT(*p)) return ASON_PARSE_INVALID_VALUE;
+        for (; p != end && ISDIGIT(*p); p++)
+            if (e < 100000000) /* saturate, far beyond any representable magnitude */
+                e = e * 10 + (*p - '0');
+        if (exp_neg) e = -e;
+        exp10 += e;
+    }
+#undef ACCUMULATE8
+#undef ACCUMULATE
+
+    /* integers that fit keep their exact value and never touch floating point */
+    if (is_int && dropped == 0 && !(neg && significand == 0)) {
+        if (!neg && significand <= (uint64_t)INT64_MAX) {
+            v->u.num.i = (int64_t)significand;
+            v->flags = ASON_F_INTEGER;
+            v->type = ASON_NUMBER;
+            c->json = p;
+            return ASON_PARSE_OK;
+        }
+        if (neg && significand - 1 <= (uint64_t)INT64_MAX) {
+            v->u.num.i = -(int64_t)(significand - 1) - 1;
+            v->flags = ASON_F_INTEGER;
+            v->type = ASON_NUMBER;
+            c->json = p;
+            return ASON_PARSE_OK;
+        }
+    }
+
+    if (significand == 0 || kept + exp10 <= -324)
+        d = 0.0;
+    else if (kept + exp10 > 309)
+        return ASON_PARSE_NUMBER_TOO_BIG;
+    else if (dropped == 0 && significand <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+        /* Clinger's fast path: exact operands give a correctly rounded result */
+        d = (double)significand;
+        d = exp10 < 0 ? d / ason_exact_pow10[-exp10] : d * ason_exact_pow10[exp10];
+    }
+    else if (!ason_strtod_diyfp(significand + (uint64_t)round_up, exp10, kept, inexact, &d))
+        d = ason_strtod_fallback(digits, p, e - frac_digits);
+    if (d == HUGE_VAL)
+        return ASON_PARSE_NUMBER_TOO_BIG;
+    v->u.num.d = neg ? -d : d;
+    v->type = ASON_NUMBER;
+    c->json = p;
+    return ASON_PARSE_OK;
+}
+
+/* v itself, or its raw text converted into tmp; numbers too big for a double become infinite */
+static const ason_value* ason_number_value(const ason_value* v, ason_value* tmp) {
+    ason_context c;
+    if (!(v->flags & ASON_F_RAW))
+        return v;
+    ason_context_init(&c, v->u.s, ASON_SIZE(v), 0);
+    ason_init(tmp);
+    if (ason_parse_number(&c, tmp) != ASON_PARSE_OK) {
+        tmp->u.num.d = *v->u.s == '-' ? -HUGE_VAL : HUGE_VAL;
+        tmp->flags = 0;
+    }
+    return tmp;
+}
+
+#define STRING_ERROR(ret) do { c->top = head; return ret; } while(0)
+
+static const char* ason_parse_hex4(const char* p, const char* end, unsigned* u) {
+    int i;
+    *u = 0;
+    if (end - p < 4)
+        return NULL;
+    for (i=0; i<4; i++) {
+        char ch = *p++;
+        *u <<= 4;
+        if      (ch >= '0' && ch <= '9') *u |= ch - '0';
+        else if (ch >= 'a' && ch <= 'f') *u |= ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F') *u |= ch - 'A' + 10;
+        else return NULL;
+    }
+    return p;
+}
+
+static size_t ason_encode_utf8(char* out, unsigned u) {
+    if (u <= 0x7F) {
+        out[0] = (char)(u & 0xFF);
+        return 1;
+    }
+    else if (u <= 0x7FF) {
+        out[0] = (char)(0xC0 | ((u >>  6) & 0xFF));
+        out[1] = (char)(0x80 | ( u        & 0x3F));
+        return 2;
+    }
+    else if (u <= 0xFFFF) {
+        out[0] = (char)(0xE0 | ((u >> 12) & 0xFF));
+        out[1] = (char)(0x80 | ((u >>  6) & 0x3F));
+        out[2] = (char)(0x80 | ( u        & 0x3F));
+        return 3;
+    }
+    else {
+        assert(u <= 0x10FFFF);
+        out[0] = (char)(0xF0 | ((u >> 18) & 0xFF));
+        out[1] = (char)(0x80 | ((u >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((u >>  6) & 0x3F));
+        out[3] = (char)(0x80 | ( u        & 0x3F));
+        return 4;
+    }
+}
+
+/*
+ * Decodes the escape sequence after a backslash into out (at most 4 bytes, never
+ * more than the sequence itself). Returns the input past it, or NULL with *ret set.
+ */
+static const char* ason_parse_escape(const char* p, const char* end, char* out, size_t* n, int* ret) {
+    unsigned u, ul;
+    *n = 1;
+    switch (p != end ? *p++ : '\0') {
+        case '\\': *out = '\\'; return p;
+        case '"' : *out = '"';  return p;
+        case '/' : *out = '/';  return p;
+        case 'b' : *out = '\b'; return p;
+        case 'f' : *out = '\f'; return p;
+        case 'n' : *out = '\n'; return p;
+        case 'r' : *out = '\r'; return p;
+        case 't' : *out = '\t'; return p;
+        case 'u' :
+            if (!(p = ason_parse_hex4(p, end, &u))) {
+                *ret = ASON_PARSE_INVALID_UNICODE_HEX;
+                return NULL;
+            }
+            if (u >= 0xDC00 && u <= 0xDFFF) {
+                *ret = ASON_PARSE_INVALID_UNICODE_SURROGATE;
+                return NULL;
+            }
+            /* surrogate pair */
+            if (u >= 0xD800 && u <= 0xDBFF) {
+                if (end - p < 2 || p[0] != '\\' || p[1] != 'u') {
+                    *ret = ASON_PARSE_INVALID_UNICODE_SURROGATE;
+                    return NULL;
+                }
+                p+=2;
+                if (!(p = ason_parse_hex4(p, end, &ul))) {
+                    *ret = ASON_PARSE_INVALID_UNICODE_HEX;
+                    return NULL;
+                }
+                if (ul < 0xDC00 || ul > 0xDFFF) {
+                    *ret = ASON_PARSE_INVALID_UNICODE_SURROGATE;
+                    return NULL;
+                }
+                u = (((u - 0xD800) << 10) | (ul - 0xDC00)) + 0x10000;
+            }
+            *n = ason_encode_utf8(out, u);
+            return p;
+        default:
+            *ret = ASON_PARSE_INVALID_STRING_ESCAPE;
+            return NULL;
+    }
+}
+
+/* decodes in place: the string ends up at its own position in the input, '\0' terminated */
+static int ason_parse_string_insitu(ason_context* c, ason_string* s) {
+    const char *p, *q;
+    char *start, *w;
+    size_t n;
+    int ret;
+    EXPECT(c, '"');
+    p = c->json;
+    start = w = (char*)p;
+    while (1) {
+        q = ason_scan_string(p, c->end);
+        if (c->utf8 && !ason_utf8_valid(p, q))
+            return ASON_PARSE_INVALID_UTF8;
+        if (w != p)
+            memmove(w, p, (size_t)(q - p));
+        w += q - p;
+        p = q;
+        if (p == c->end)
+            return ASON_PARSE_MISS_QUOTATION_MARK;
+        switch (*p++) {
+            case '"':
+                *w = '\0';
+                s->s = start;
+                s->len = (size_t)(w - start);
+                c->json = p;
+                return ASON_PARSE_OK;
+            case '\\':
+                if (!(p = ason_parse_escape(p, c->end, w, &n, &ret)))
+                    return ret;
+                w += n;
+                break;
+            default:
+                return ASON_PARSE_INVALID_STRING_CHAR;
+        }
+    }
+}
+
+/* *str points into the input, or at the decoded copy on the stack which the caller pops */
+static int ason_parse_string_raw(ason_context* c, const char** str, size_t* len) {
+    size_t head = c->top, n;
+    const char *p, *q;
+    int ret;
+    EXPECT(c, '"');
+    p = c->json;
+    while (1) {
+        char ch;
+        /* copy the run of plain characters in one go */
+        q = ason_scan_string(p, c->end);
+        if (c->utf8 && !ason_utf8_valid(p, q))
+            STRING_ERROR(ASON_PARSE_INVALID_UTF8);
+        if (q != c->end && *q == '"' && c->top == head) {
+            /* no escapes at all: straight from the input */
+            *str = p;
+            *len = (size_t)(q - p);
+            c->json = q + 1;
+            return ASON_PARSE_OK;
+        }
+        if (q != p) {
+            memcpy(ason_context_push(c, (size_t)(q - p)), p, (size_t)(q - p));
+            p = q;
+        }
+        if (p == c->end)
+            STRING_ERROR(ASON_PARSE_MISS_QUOTATION_MARK);
+        ch = *p++;
+        switch (ch) {
+            case '"':
+                *len = c->top - head;
+                *str = c->stack + head;
+                c->json = p;
+                return ASON_PARSE_OK;
+            case '\\':
+                if (!(p = ason_parse_escape(p, c->end, (char*)ason_context_push(c, 4), &n, &ret)))
+                    STRING_ERROR(ret);
+                c->top -= 4 - n;
+                break;
+            default:
+                /* the scanner only stops at control characters here */
+                STRING_ERROR(ASON_PARSE_INVALID_STRING_CHAR);
+        }
+    }
+}
+
+static int _ason_parse_string(ason_context* c, ason_string* s) {
+    size_t head = c->top, len;
+    const char* str;
+    int ret;
+    if (c->insitu)
+        return ason_parse_string_insitu(c, s);
+    if ((ret = ason_parse_string_raw(c, &str, &len)) == ASON_PARSE_OK) {
+        ason_context_new_string(c, s, str, len);
+        c->top = head;
+    }
+    return ret;
+}
+
+static int ason_parse_string(ason_context* c, ason_value* v) {
+    size_t head = c->top, len;
+    const char* s;
+    ason_string str;
+    int ret;
+    if (c->insitu) {
+        if ((ret = ason_parse_string_insitu(c, &str)) == ASON_PARSE_OK) {
+            v->u.s = str.s;
+            ASON_SET_SIZE(v, str.len);
+            v->type = ASON_STRING;
+            v->flags = ASON_F_BORROWED;
+        }
+        return ret;
+    }
+    if ((ret = ason_parse_string_raw(c, &s, &len)) == ASON_PARSE_OK) {
+        ason_value_set_string(v, s, len, c->arena);
+        c->top = head;
+    }
+    return ret;
+}
+
+/* an open container */
+typedef struct {
+    ason_type type;
+    size_t size; /* members on the context stack, the entry of a pending key included */
+} ason_frame;
+
+/* moves the top size members of the stack into v */
+static void ason_context_pop_array(ason_context* c, ason_value* v, size_t size) {
+    v->type = ASON_ARRAY;
+    ASON_SET_SIZE(v, size);
+    if (size == 0) {
+        v->u.m = NULL;
+        return;
+    }
+    v->flags = c->arena ? ASON_F_BORROWED : 0;
+    v->u.m = (ason_value*)ason_context_alloc_elements(c, size, sizeof(ason_value));
+    memcpy(v->u.m, ason_context_pop(c, size * sizeof(ason_value)), size * sizeof(ason_value));
+}
+
+/* power of two, at most half full */
+static size_t ason_object_index_capacity(size_t size) {
+    size_t cap = 8;
+    while (cap < size * 2)
+        cap <<= 1;
+    return cap;
+}
+
+/* open addressing with linear probing, slots hold entry index + 1 */
+static void ason_object_index_build(const ason_value* v, uint32_t* slots) {
+    const ason_entry* e = v->u.e;
+    size_t i, j, size = ASON_SIZE(v), mask = ason_object_index_capacity(size) - 1;
+    uint32_t hash;
+    memset(slots, 0, (mask + 1) * sizeof(uint32_t));
+    for (i = 0; i < size; i++) {
+        hash = v->flags & ASON_F_KEYS_INTERNED ? ASON_KEY_OF(e[i].k.s)->hash : ason_hash_key(e[i].k.s, e[i].k.len);
+        for (j = hash & mask; slots[j] != 0; j = (j + 1) & mask)
+            ;
+        slots[j] = (uint32_t)(i + 1);
+    }
+}
+
+static void ason_context_pop_object(ason_context* c, ason_value* v, size_t size) {
+    v->type = ASON_OBJECT;
+    ASON_SET_SIZE(v, size);
+    if (size == 0) {
+        v->u.e = NULL;
+        return;
+    }
+    v->flags = c->arena ? ASON_F_BORROWED | ASON_F_KEYS_BORROWED : (c->insitu ? ASON_F_KEYS_BORROWED : 0);
+    if (c->intern != NULL)
+        v->flags |= ASON_F_KEYS_INTERNED;
+    v->u.e = (ason_entry*)ason_context_alloc_elements(c, size, sizeof(ason_entry));
+    memcpy(v->u.e, ason_context_pop(c, size * sizeof(ason_entry)), size * sizeof(ason_entry));
+    /* arena objects are never freed one by one, so index them now from the arena */
+    if (c->arena && size >= ASON_OBJECT_INDEX_MIN_SIZE) {
+        ASON_OBJECT_INDEX(v) = (uint32_t*)ason_context_alloc(c, ason_object_index_capacity(size) * sizeof(uint32_t));
+        ason_object_index_build(v, ASON_OBJECT_INDEX(v));
+    }
+}
+
+static void _ason_free_value(ason_value* m, size_t size) {
+    size_t i = 0;
+    for (i = 0; i < size; i++)
+        ason_free(&m[i]);
+}
+
+static void _ason_free_entry(ason_context* c, ason_entry* e, size_t size) {
+    size_t i = 0;
+    for (i = 0; i < size; i++) {
+        ason_free(&e[i].v);
+        ason_context_free_key(c, e[i].k.s);
+    }
+}
+
+static int ason_parse_key(ason_context* c, ason_string* k) {
+    size_t head = c->top;
+    const char* s;
+    int ret;
+    if (c->intern == NULL)
+        return _ason_parse_string(c, k);
+    if ((ret = ason_parse_string_raw(c, &s, &k->len)) == ASON_PARSE_OK) {
+        k->s = ason_context_intern(c, s, k->len);
+        c->top = head;
+    }
+    return ret;
+}
+
+/* pushes the entry of the next member with a null value, which is replaced once parsed */
+static int ason_parse_member_key(ason_context* c) {
+    ason_entry e;
+    if (PEEK(c) != '"' || ason_parse_key(c, &e.k) != ASON_PARSE_OK)
+        return ASON_PARSE_MISS_KEY;
+    ason_parse_whitespace(c);
+    if (PEEK(c) != ':') {
+        ason_context_free_key(c, e.k.s);
+        return ASON_PARSE_MISS_COLON;
+    }
+    c->json++;
+    ason_parse_whitespace(c);
+    ason_init(&e.v);
+    memcpy(ason_context_push(c, sizeof(ason_entry)), &e, sizeof(ason_entry));
+    return ASON_PARSE_OK;
+}
+
+/*
+ * Iterative: the members of each open container sit on the context stack above an
+ * ason_frame that saves the enclosing one, so nesting costs no C stack.
+ */
+static int ason_parse_value(ason_context* c, ason_value* v) {
+    ason_frame f; /* the innermost open container, ASON_NULL at the root */
+    ason_value m;
+    size_t depth = 0;
+    int ret;
+    f.type = ASON_NULL;
+    f.size = 0;
+    for (;;) {
+        ason_init(&m);
+        switch (PEEK(c)) {
+            case 'n' : ret = ason_parse_literal(c, &m, "null", 4, ASON_NULL); break;
+            case 'f' : ret = ason_parse_literal(c, &m, "false", 5, ASON_FALSE); break;
+            case 't' : ret = ason_parse_literal(c, &m, "true", 4, ASON_TRUE); break;
+            default  : ret = ason_parse_number(c, &m); break;
+            case '"' : ret = ason_parse_string(c, &m); break;
+            case '\0': ret = ASON_PARSE_EXPECT_VALUE; break;
+            case '[' :
+            case '{' :
+                if (depth == ASON_PARSE_MAX_DEPTH) {
+                    ret = ASON_PARSE_DEPTH_EXCEEDED;
+                    goto error;
+                }
+                memcpy(ason_context_push(c, sizeof(ason_frame)), &f, sizeof(ason_frame));
+                f.type = *c->json++ == '[' ? ASON_ARRAY : ASON_OBJECT;
+                f.size = 0;
+                depth++;
+                ason_parse_whitespace(c);
+                if (PEEK(c) == (f.type == ASON_ARRAY ? ']' : '}')) {
+                    c->json++;
+                    goto close;
+                }
+                if (f.type == ASON_OBJECT) {
+                    if ((ret = ason_parse_member_key(c)) != ASON_PARSE_OK)
+                        goto error;
+                    f.size++;
+                }
+                continue;
+        }
+        if (ret != ASON_PARSE_OK)
+            goto error;
+    done:
+        /* m is complete, store it and move on to the next member or close the container */
+        if (depth == 0) {
+            memcpy(v, &m, sizeof(ason_value));
+            return ASON_PARSE_OK;
+        }
+        if (f.type == ASON_ARRAY) {
+            memcpy(ason_context_push(c, sizeof(ason_value)), &m, sizeof(ason_value));
+            f.size++;
+        }
+        else
+            memcpy(&((ason_entry*)(c->stack + c->top) - 1)->v, &m, sizeof(ason_value));
+        ason_parse_whitespace(c);
+        if (PEEK(c) == ',') {
+            c->json++;
+            ason_parse_whitespace(c);
+            if (f.type == ASON_OBJECT) {
+                if ((ret = ason_parse_member_key(c)) != ASON_PARSE_OK)
+                    goto error;
+                f.size++;
+            }
+            continue;
+        }
+        if (PEEK(c) != (f.type == ASON_ARRAY ? ']' : '}')) {
+            ret = f.type == ASON_ARRAY ? ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            goto error;
+        }
+        c->json++;
+    close:
+        if (f.type == ASON_ARRAY)
+            ason_context_pop_array(c, &m, f.size);
+        else
+            ason_context_pop_object(c, &m, f.size);
+        memcpy(&f, ason_context_pop(c, sizeof(ason_frame)), sizeof(ason_frame));
+        depth--;
+        goto done;
+    }
+error:
+    for (; depth > 0; depth--) {
+        if (f.type == ASON_ARRAY)
+            _ason_free_value((ason_value*)ason_context_pop(c, f.size * sizeof(ason_value)), f.size);
+        else
+            _ason_free_entry(c, (ason_entry*)ason_context_pop(c, f.size * sizeof(ason_entry)), f.size);
+        memcpy(&f, ason_context_pop(c, sizeof(ason_frame)), sizeof(ason_frame));
+    }
+    return ret;
+}
+
+static int ason_parse_root(ason_context* c, ason_value* v) {
+    int ret;
+    ason_parse_whitespace(c);
+    if ((ret = ason_parse_value(c, v)) == ASON_PARSE_OK) {
+        ason_parse_whitespace(c);
+        if (c->json != c->end) {
+            ason_free(v);
+            ret = ASON_PARSE_ROOT_NOT_SINGULAR;
+        }
+    }
+    assert(c->top == 0);
+    return ret;
+}
+
+int ason_parse_ex(ason_value* v, const char* json, size_t len, unsigned flags) {
+    ason_context c;
+    int ret;
+    assert(v != NULL && (json != NULL || len == 0));
+    ason_context_init(&c, json, len, flags);
+    ason_init(v);
+    ret = ason_parse_root(&c, v);
+    ason_context_release(&c);
+    return ret;
+}
+
+int ason_parse_n(ason_value* v, const char* json, size_t len) {
+    return ason_parse_ex(v, json, len, 0);
+}
+
+int ason_parse(ason_value* v, const char* json) {
+    assert(json != NULL);
+    return ason_parse_ex(v, json, strlen(json), 0);
+}
+
+int ason_parse_insitu(ason_value* v, char* json, size_t len) {
+    ason_context c;
+    int ret;
+    assert(v != NULL && (json != NULL || len == 0));
+    ason_context_init(&c, json, len, 0);
+    c.insitu = 1;
+    ason_init(v);
+    ret = ason_parse_root(&c, v);
+    ASON_FREE(c.stack);
+    return ret;
+}
+
+#define ASON_SAX(h, event, args) ((h)->event == NULL || (h)->event args ? ASON_PARSE_OK : ASON_PARSE_ABORTED)
+
+
+static int ason_sax_string(ason_context* c, const ason_sax_handler* h, void* ctx, int is_key) {
+    size_t head = c->top, len;
+    const char* s;
+    int ret;
+    if ((ret = ason_parse_string_raw(c, &s, &len)) == ASON_PARSE_OK)
+        ret = is_key ? ASON_SAX(h, key, (ctx, s, len)) : ASON_SAX(h, string, (ctx, s, len));
+    c->top = head;
+    return ret;
+}
+
+static int ason_sax_key(ason_context* c, const ason_sax_handler* h, void* ctx) {
+    int ret;
+    if (PEEK(c) != '"')
+        return ASON_PARSE_MISS_KEY;
+    if ((ret = ason_sax_string(c, h, ctx, 1)) != ASON_PARSE_OK)
+        return ret == ASON_PARSE_ABORTED ? ret : ASON_PARSE_MISS_KEY;
+    ason_parse_whitespace(c);
+    if (PEEK(c) != ':')
+        return ASON_PARSE_MISS_COLON;
+    c->json++;
+    ason_parse_whitespace(c);
+    return ASON_PARSE_OK;
+}
+
+static int ason_sax_scalar(ason_context* c, const ason_sax_handler* h, void* ctx) {
+    ason_value v;
+    int ret;
+    ason_init(&v);
+    switch (PEEK(c)) {
+        case 'n' :
+            if ((ret = ason_parse_literal(c, &v, "null", 4, ASON_NULL)) != ASON_PARSE_OK)
+                return ret;
+            return ASON_SAX(h, null, (ctx));
+        case 'f' :
+            if ((ret = ason_parse_literal(c, &v, "false", 5, ASON_FALSE)) != ASON_PARSE_OK)
+                return ret;
+            return ASON_SAX(h, boolean, (ctx, 0));
+        case 't' :
+            if ((ret = ason_parse_literal(c, &v, "true", 4, ASON_TRUE)) != ASON_PARSE_OK)
+                return ret;
+            return ASON_SAX(h, boolean, (ctx, 1));
+        default  :
+            if ((ret = ason_parse_number(c, &v)) != ASON_PARSE_OK)
+                return ret;
+            if (!(v.flags & ASON_F_INTEGER))
+                return ASON_SAX(h, number, (ctx, v.u.num.d));
+            if (h->integer)
+                return ASON_SAX(h, integer, (ctx, v.u.num.i));
+            return ASON_SAX(h, number, (ctx, (double)v.u.num.i));
+        case '"' : return ason_sax_string(c, h, ctx, 0);
+        case '\0': return ASON_PARSE_EXPECT_VALUE;
+    }
+}
+
+/* iterative like ason_parse_value, the context stack only holds the saved frames */
+static int ason_sax_value(ason_context* c, const ason_sax_handler* h, void* ctx) {
+    ason_frame f;
+    size_t depth = 0;
+    int ret;
+    f.type = ASON_NULL;
+    f.size = 0;
+    for (;;) {
+        if (PEEK(c) == '[' || PEEK(c) == '{') {
+            if (depth == ASON_PARSE_MAX_DEPTH)
+                return ASON_PARSE_DEPTH_EXCEEDED;
+            memcpy(ason_context_push(c, sizeof(ason_frame)), &f, sizeof(ason_frame));
+            f.type = *c->json++ == '[' ? ASON_ARRAY : ASON_OBJECT;
+            f.size = 0;
+            depth++;
+            if ((ret = f.type == ASON_ARRAY ? ASON_SAX(h, start_array, (ctx)) : ASON_SAX(h, start_object, (ctx))) != ASON_PARSE_OK)
+                return ret;
+            ason_parse_whitespace(c);
+            if (PEEK(c) == (f.type == ASON_ARRAY ? ']' : '}')) {
+                c->json++;
+                goto close;
+            }
+            if (f.type == ASON_OBJECT && (ret = ason_sax_key(c, h, ctx)) != ASON_PARSE_OK)
+                return ret;
+            continue;
+        }
+        if ((ret = ason_sax_scalar(c, h, ctx)) != ASON_PARSE_OK)
+            return ret;
+    done:
+        if (depth == 0)
+            return ASON_PARSE_OK;
+        f.size++;
+        ason_parse_whitespace(c);
+        if (PEEK(c) == ',') {
+            c->json++;
+            ason_parse_whitespace(c);
+            if (f.type == ASON_OBJECT && (ret = ason_sax_key(c, h, ctx)) != ASON_PARSE_OK)
+                return ret;
+            continue;
+        }
+        if (PEEK(c) != (f.type == ASON_ARRAY ? ']' : '}'))
+            return f.type == ASON_ARRAY ? ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        c->json++;
+    close:
+        ret = f.type == ASON_ARRAY ? ASON_SAX(h, end_array, (ctx, f.size)) : ASON_SAX(h, end_object, (ctx, f.size));
+        memcpy(&f, ason_context_pop(c, sizeof(ason_frame)), sizeof(ason_frame));
+        depth--;
+        if (ret != ASON_PARSE_OK)
+            return ret;
+        goto done;
+    }
+}
+
+int ason_parse_sax(const ason_sax_handler* handler, void* ctx, const char* json, size_t len) {
+    ason_context c;
+    int ret;
+    assert(handler != NULL && (json != NULL || len == 0));
+    ason_context_init(&c, json, len, 0);
+    ason_parse_whitespace(&c);
+    if ((ret = ason_sax_value(&c, handler, ctx)) == ASON_PARSE_OK) {
+        ason_parse_whitespace(&c);
+        if (c.json != c.end)
+            ret = ASON_PARSE_ROOT_NOT_SINGULAR;
+    }
+    ASON_FREE(c.stack);
+    return ret;
+}
+
+/* checks a string without decoding it */
+static int ason_validate_string(ason_context* c) {
+    const char *p, *q;
+    char out[4];
+    size_t n;
+    int ret;
+    EXPECT(c, '"');
+    p = c->json;
+    while (1) {
+        q = ason_scan_string(p, c->end);
+        if (c->utf8 && !ason_utf8_valid(p, q))
+            return ASON_PARSE_INVALID_UTF8;
+        if ((p = q) == c->end)
+            return ASON_PARSE_MISS_QUOTATION_MARK;
+        switch (*p++) {
+            case '"':
+                c->json = p;
+                return ASON_PARSE_OK;
+            case '\\':
+                if (!(p = ason_parse_escape(p, c->end, out, &n, &ret)))
+                    return ret;
+                break;
+            default:
+                return ASON_PARSE_INVALID_STRING_CHAR;
+        }
+    }
+}
+
+static int ason_validate_key(ason_context* c) {
+    if (PEEK(c) != '"' || ason_validate_string(c) != ASON_PARSE_OK)
+        return ASON_PARSE_MISS_KEY;
+    ason_parse_whitespace(c);
+    if (PEEK(c) != ':')
+        return ASON_PARSE_MISS_COLON;
+    c->json++;
+    ason_parse_whitespace(c);
+    return ASON_PARSE_OK;
+}
+
+/* the grammar of ason_parse_value, open containers are one bit each */
+static int ason_validate_value(ason_context* c) {
+    unsigned char objects[(ASON_PARSE_MAX_DEPTH + 7) / 8];
+    ason_value m;
+    size_t depth = 0;
+    int ret, object = 0;
+    for (;;) {
+        switch (PEEK(c)) {
+            case 'n' : ret = ason_parse_literal(c, &m, "null", 4, ASON_NULL); break;
+            case 'f' : ret = ason_parse_literal(c, &m, "false", 5, ASON_FALSE); break;
+            case 't' : ret = ason_parse_literal(c, &m, "true", 4, ASON_TRUE); break;
+            default  : ret = ason_parse_number(c, &m); break;
+            case '"' : ret = ason_validate_string(c); break;
+            case '\0': ret = ASON_PARSE_EXPECT_VALUE; break;
+            case '[' :
+            case '{' :
+                if (depth == ASON_PARSE_MAX_DEPTH)
+                    return ASON_PARSE_DEPTH_EXCEEDED;
+                object = *c->json++ == '{';
+                if (object)
+                    objects[depth / 8] |= (unsigned char)(1 << depth % 8);
+                else
+                    objects[depth / 8] &= (unsigned char)~(1 << depth % 8);
+                depth++;
+                ason_parse_whitespace(c);
+                if (PEEK(c) == (object ? '}' : ']')) {
+                    c->json++;
+                    goto close;
+                }
+                if (object && (ret = ason_validate_key(c)) != ASON_PARSE_OK)
+                    return ret;
+                continue;
+        }
+        if (ret != ASON_PARSE_OK)
+            return ret;
+    done:
+        if (depth == 0)
+            return ASON_PARSE_OK;
+        ason_parse_whitespace(c);
+        if (PEEK(c) == ',') {
+            c->json++;
+            ason_parse_whitespace(c);
+            if (object && (ret = ason_validate_key(c)) != ASON_PARSE_OK)
+                return ret;
+            continue;
+        }
+        if (PEEK(c) != (object ? '}' : ']'))
+            return object ? ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET : ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        c->json++;
+    close:
+        depth--;
+        object = depth > 0 && (objects[(depth - 1) / 8] >> (depth - 1) % 8 & 1);
+        goto done;
+    }
+}
+
+int ason_validate(const char* json, size_t len) {
+    ason_context c;
+    int ret;
+    assert(json != NULL || len == 0);
+    ason_context_init(&c, json, len, ASON_PARSE_VALIDATE_UTF8);
+    ason_parse_whitespace(&c);
+    if ((ret = ason_validate_value(&c)) == ASON_PARSE_OK) {
+        ason_parse_whitespace(&c);
+        if (c.json != c.end)
+            ret = ASON_PARSE_ROOT_NOT_SINGULAR;
+    }
+    assert(c.stack == NULL);
+    return ret;
+}
+
+/*
+ * Push parser. Containers are tracked on an explicit frame stack, their members
+ * are collected on the context stack exactly as in ason_parse_value.
+ * A token cut by the end of a chunk is copied to tok and decoded by the shared
+ * token parsers once its last byte has arrived, so results and errors match ason_parse.
+ */
+
+enum { ASON_TOKEN_NONE, ASON_TOKEN_STRING, ASON_TOKEN_KEY, ASON_TOKEN_NUMBER, ASON_TOKEN_LITERAL };
+
+enum {
+    ASON_STATE_VALUE,
+    ASON_STATE_VALUE_OR_END,   /* after '[' */
+    ASON_STATE_KEY,
+    ASON_STATE_KEY_OR_END,     /* after '{' */
+    ASON_STATE_COLON,
+    ASON_STATE_COMMA_OR_END,
+    ASON_STATE_DONE
+};
+
+struct ason_parser {
+    ason_context c;
+    ason_frame* frames;
+    size_t depth, frame_cap;
+    char* tok;
+    size_t tok_len, tok_cap, tok_need;
+    ason_value root;
+    int state, token, escape, error;
+};
+
+#define ISNUMBERCHAR(ch) (ISDIGIT(ch) || (ch) == '-' || (ch) == '+' || (ch) == '.' || (ch) == 'e' || (ch) == 'E')
+
+static int ason_parser_scan(ason_parser* p);
+
+static void ason_parser_clear(ason_parser* p) {
+    ason_context* c = &p->c;
+    ason_frame* f;
+    while (p->depth > 0) {
+        f = &p->frames[--p->depth];
+        if (f->type == ASON_ARRAY)
+            _ason_free_value((ason_value*)ason_context_pop(c, f->size * sizeof(ason_value)), f->size);
+        else
+            _ason_free_entry(c, (ason_entry*)ason_context_pop(c, f->size * sizeof(ason_entry)), f->size);
+    }
+    ason_free(&p->root);
+    c->top = 0;
+    p->tok_len = 0;
+    p->state = ASON_STATE_VALUE;
+    p->token = ASON_TOKEN_NONE;
+    p->error = ASON_PARSE_OK;
+}
+
+ason_parser* ason_parser_create(void) {
+    ason_parser* p = (ason_parser*)ASON_MALLOC(sizeof(ason_parser));
+    ason_context_init(&p->c, NULL, 0, 0);
+    p->frames = NULL;
+    p->depth = p->frame_cap = 0;
+    p->tok = NULL;
+    p->tok_cap = 0;
+    ason_init(&p->root);
+    ason_parser_clear(p);
+    return p;
+}
+
+void ason_parser_destroy(ason_parser* p) {
+    if (p == NULL)
+        return;
+    ason_parser_clear(p);
+    ASON_FREE(p->c.stack);
+    ASON_FREE(p->frames);
+    ASON_FREE(p->tok);
+    ASON_FREE(p);
+}
+
+int ason_parser_parse(ason_parser* p, ason_value* v, const char* json, size_t len) {
+    ason_context* c;
+    assert(p != NULL && v != NULL && (json != NULL || len == 0));
+    ason_parser_clear(p);
+    c = &p->c;
+    c->json = json;
+    c->end = c->limit = json + len;
+    ason_init(v);
+    return ason_parse_root(c, v);
+}
+
+void ason_parser_shrink(ason_parser* p) {
+    assert(p != NULL);
+    if (p->c.top == 0) {
+        ASON_FREE(p->c.stack);
+        p->c.stack = NULL;
+        p->c.size = 0;
+    }
+    if (p->depth == 0) {
+        ASON_FREE(p->frames);
+        p->frames = NULL;
+        p->frame_cap = 0;
+    }
+    if (p->tok_len == 0) {
+        ASON_FREE(p->tok);
+        p->tok = NULL;
+        p->tok_cap = 0;
+    }
+}
+
+static int ason_parser_push_frame(ason_parser* p, ason_type type) {
+    if (p->depth == ASON_PARSE_MAX_DEPTH)
+        return ASON_PARSE_DEPTH_EXCEEDED;
+    if (p->depth == p->frame_cap) {
+        p->frame_cap = p->frame_cap ? p->frame_cap * 2 : 16;
+        p->frames = (ason_frame*)ASON_REALLOC(p->frames, p->frame_cap * sizeof(ason_frame));
+    }
+    p->frames[p->depth].type = type;
+    p->frames[p->depth].size = 0;
+    p->depth++;
+    p->state = type == ASON_ARRAY ? ASON_STATE_VALUE_OR_END : ASON_STATE_KEY_OR_END;
+    return ASON_PARSE_OK;
+}
+
+static void ason_parser_value_done(ason_parser* p, ason_value* v) {
+    ason_context* c = &p->c;
+    ason_frame* f;
+    if (p->depth == 0) {
+        p->root = *v;
+        p->state = ASON_STATE_DONE;
+        return;
+    }
+    f = &p->frames[p->depth - 1];
+    if (f->type == ASON_ARRAY) {
+        memcpy(ason_context_push(c, sizeof(ason_value)), v, sizeof(ason_value));
+        f->size++;
+    }
+    else /* the entry was pushed with its key */
+        ((ason_entry*)(c->stack + c->top) - 1)->v = *v;
+    p->state = ASON_STATE_COMMA_OR_END;
+}
+
+static void ason_parser_close(ason_parser* p) {
+    ason_frame* f = &p->frames[--p->depth];
+    ason_value v;
+    ason_init(&v);
+    if (f->type == ASON_ARRAY)
+        ason_context_pop_array(&p->c, &v, f->size);
+    else
+        ason_context_pop_object(&p->c, &v, f->size);
+    ason_parser_value_done(p, &v);
+}
+
+/* decodes the complete token text in c->json..c->end */
+static int ason_parser_decode(ason_parser* p) {
+    ason_context* c = &p->c;
+    ason_entry* e;
+    ason_string k;
+    ason_value v;
+    int ret;
+    int token = p->token;
+    p->token = ASON_TOKEN_NONE;
+    ason_init(&v);
+    switch (token) {
+        case ASON_TOKEN_KEY:
+            if (_ason_parse_string(c, &k) != ASON_PARSE_OK)
+                return ASON_PARSE_MISS_KEY;
+            e = (ason_entry*)ason_context_push(c, sizeof(ason_entry));
+            e->k = k;
+            ason_init(&e->v);
+            p->frames[p->depth - 1].size++;
+            p->state = ASON_STATE_COLON;
+            return ASON_PARSE_OK;
+        case ASON_TOKEN_STRING:
+            ret = ason_parse_string(c, &v);
+            break;
+        case ASON_TOKEN_NUMBER:
+            ret = ason_parse_number(c, &v);
+            break;
+        default:
+            switch (*c->json) {
+                case 'n': ret = ason_parse_literal(c, &v, "null", 4, ASON_NULL); break;
+                case 't': ret = ason_parse_literal(c, &v, "true", 4, ASON_TRUE); break;
+                default : ret = ason_parse_literal(c, &v, "false", 5, ASON_FALSE); break;
+            }
+    }
+    if (ret == ASON_PARSE_OK)
+        ason_parser_value_done(p, &v);
+    return ret;
+}
+
+static void ason_parser_append(ason_parser* p, const char* s, size_t len) {
+    if (p->tok_len + len > p->tok_cap) {
+        while (p->tok_len + len > p->tok_cap)
+            p->tok_cap = p->tok_cap ? p->tok_cap * 2 : 64;
+        p->tok = (char*)ASON_REALLOC(p->tok, p->tok_cap);
+    }
+    memcpy(p->tok + p->tok_len, s, len);
+    p->tok_len += len;
+}
+
+/* one past the closing quote, or NULL when the string goes on past end */
+static const char* ason_parser_string_end(ason_parser* p, const char* s, const char* end) {
+    while (s != end) {
+        if (p->escape) {
+            p->escape = 0;
+            s++;
+            continue;
+        }
+        if ((s = ason_scan_string(s, end)) == end)
+            break;
+        if (*s == '"')
+            return s + 1;
+        if (*s == '\\')
+            p->escape = 1;
+        s++;
+    }
+    return NULL;
+}
+
+/* the token's bytes in this chunk start at c->json, its end is searched from "from" */
+static int ason_parser_token(ason_parser* p, const char* from) {
+    ason_context* c = &p->c;
+    const char *s = c->json, *end = c->end, *t;
+    int ret, complete;
+    switch (p->token) {
+        case ASON_TOKEN_STRING:
+        case ASON_TOKEN_KEY:
+            complete = (t = ason_parser_string_end(p, from, end)) != NULL;
+            if (!complete)
+                t = end;
+            break;
+        case ASON_TOKEN_NUMBER:
+            for (t = from; t != end && ISNUMBERCHAR(*t); t++)
+                ;
+            complete = t != end;
+            break;
+        default:
+            t = (size_t)(end - s) < p->tok_need - p->tok_len ? end : s + (p->tok_need - p->tok_len);
+            complete = p->tok_len + (size_t)(t - s) == p->tok_need;
+    }
+    if (!complete) {
+        ason_parser_append(p, s, (size_t)(t - s));
+        c->json = t;
+        return ASON_PARSE_OK;
+    }
+    if (p->tok_len == 0) {
+        /* entirely inside this chunk: straight from the input, the loop goes on after it */
+        c->end = t;
+        ret = ason_parser_decode(p);
+        c->end = end;
+        return ret;
+    }
+    ason_parser_append(p, s, (size_t)(t - s));
+    c->json = p->tok;
+    c->end = c->limit = p->tok + p->tok_len; /* nothing past tok is readable */
+    ret = ason_parser_decode(p);
+    if (ret == ASON_PARSE_OK && c->json != c->end)
+        ret = ason_parser_scan(p); /* bytes a number did not take, always an error */
+    p->tok_len = 0;
+    c->json = t;
+    c->end = c->limit = end;
+    return ret;
+}
+
+static int ason_parser_start_token(ason_parser* p, int token, size_t need) {
+    p->token = token;
+    p->tok_need = need;
+    p->escape = 0;
+    return ason_parser_token(p, p->c.json + (token == ASON_TOKEN_STRING || token == ASON_TOKEN_KEY));
+}
+
+static int ason_parser_scan(ason_parser* p) {
+    ason_context* c = &p->c;
+    ason_frame* f;
+    int ret;
+    char ch;
+    while (1) {
+        ason_parse_whitespace(c);
+        if (c->json == c->end)
+            return ASON_PARSE_OK;
+        ch = *c->json;
+        f = p->depth ? &p->frames[p->depth - 1] : NULL;
+        switch (p->state) {
+            case ASON_STATE_VALUE_OR_END:
+                if (ch == ']') {
+                    c->json++;
+                    ason_parser_close(p);
+                    break;
+                }
+                /* fall through */
+            case ASON_STATE_VALUE:
+                switch (ch) {
+                    case '[' : c->json++; ret = ason_parser_push_frame(p, ASON_ARRAY); break;
+                    case '{' : c->json++; ret = ason_parser_push_frame(p, ASON_OBJECT); break;
+                    case '"' : ret = ason_parser_start_token(p, ASON_TOKEN_STRING, 0); break;
+                    case 'n' :
+                    case 't' : ret = ason_parser_start_token(p, ASON_TOKEN_LITERAL, 4); break;
+                    case 'f' : ret = ason_parser_start_token(p, ASON_TOKEN_LITERAL, 5); break;
+                    case '\0': return ASON_PARSE_EXPECT_VALUE;
+                    default  :
+                        if (ch != '-' && !ISDIGIT(ch))
+                            return ASON_PARSE_INVALID_VALUE;
+                        ret = ason_parser_start_token(p, ASON_TOKEN_NUMBER, 0);
+                }
+                if (ret != ASON_PARSE_OK)
+                    return ret;
+                break;
+            case ASON_STATE_KEY_OR_END:
+                if (ch == '}') {
+                    c->json++;
+                    ason_parser_close(p);
+                    break;
+                }
+                /* fall through */
+            case ASON_STATE_KEY:
+                if (ch != '"')
+                    return ASON_PARSE_MISS_KEY;
+                if ((ret = ason_parser_start_token(p, ASON_TOKEN_KEY, 0)) != ASON_PARSE_OK)
+                    return ret;
+                break;
+            case ASON_STATE_COLON:
+                if (ch != ':')
+                    return ASON_PARSE_MISS_COLON;
+                c->json++;
+                p->state = ASON_STATE_VALUE;
+                break;
+            case ASON_STATE_COMMA_OR_END:
+                if (ch == ',') {
+                    c->json++;
+                    p->state = f->type == ASON_ARRAY ? ASON_STATE_VALUE : ASON_STATE_KEY;
+                }
+                else if (ch == (f->type == ASON_ARRAY ? ']' : '}')) {
+                    c->json++;
+                    ason_parser_close(p);
+                }
+                else
+                    return f->type == ASON_ARRAY ? ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                break;
+            default:
+                return ASON_PARSE_ROOT_NOT_SINGULAR;
+        }
+    }
+}
+
+int ason_parser_feed(ason_parser* p, const char* chunk, size_t len) {
+    ason_context* c;
+    int ret = ASON_PARSE_OK;
+    assert(p != NULL && (chunk != NULL || len == 0));
+    if (p->error != ASON_PARSE_OK)
+        return p->error;
+    c = &p->c;
+    c->json = chunk;
+    c->end = c->limit = chunk + len;
+    if (p->token != ASON_TOKEN_NONE)
+        ret = ason_parser_token(p, chunk);
+    if (ret == ASON_PARSE_OK)
+        ret = ason_parser_scan(p);
+    if (ret != ASON_PARSE_OK) {
+        ason_parser_clear(p);
+        p->error = ret;
+    }
+    return ret;
+}
+
+int ason_parser_finish(ason_parser* p, ason_value* v) {
+    static const char nul = '\0';
+    ason_context* c;
+    int ret;
+    assert(p != NULL && v != NULL);
+    c = &p->c;
+    ret = p->error;
+    if (ret == ASON_PARSE_OK && p->token != ASON_TOKEN_NONE) {
+        /* the end of input completes a number, anything else was cut short */
+        c->json = p->tok;
+        c->end = c->limit = p->tok + p->tok_len;
+        if ((ret = ason_parser_decode(p)) == ASON_PARSE_OK && c->json != c->end)
+            ret = ason_parser_scan(p);
+    }
+    if (ret == ASON_PARSE_OK && p->state != ASON_STATE_DONE) {
+        /* the end of input reads as '\0' like PEEK does */
+        c->json = &nul;
+        c->end = c->limit = &nul + 1;
+        ret = ason_parser_scan(p);
+    }
+    ason_init(v);
+    if (ret == ASON_PARSE_OK) {
+        *v = p->root;
+        ason_init(&p->root);
+    }
+    ason_parser_clear(p);
+    return ret;
+}
+
+ason_document* ason_document_create(void) {
+    return ason_document_create_ex(NULL);
+}
+
+ason_document* ason_document_create_ex(const ason_allocator* allocator) {
+    ason_document* doc;
+    if (allocator == NULL)
+        allocator = &ason_global_allocator;
+    doc = (ason_document*)ASON_A_MALLOC(allocator, sizeof(ason_document));
+    doc->alloc = *allocator;
+    ason_init(&doc->root);
+    ason_arena_init(&doc->arena, &doc->alloc);
+    return doc;
+}
+
+void ason_document_free(ason_document* doc) {
+    ason_allocator alloc;
+    if (doc == NULL)
+        return;
+    alloc = doc->alloc;
+    ason_arena_release(&doc->arena);
+    ASON_A_FREE(&alloc, doc);
+}
+
+int ason_document_parse_ex(ason_document* doc, const char* json, size_t len, unsigned flags) {
+    ason_context c;
+    int ret;
+    assert(doc != NULL && (json != NULL || len == 0));
+    ason_init(&doc->root);
+    ason_arena_reset(&doc->arena);
+    ason_context_init_alloc(&c, json, len, flags, &doc->alloc);
+    c.arena = &doc->arena;
+    if ((ret = ason_parse_root(&c, &doc->root)) != ASON_PARSE_OK)
+        ason_arena_reset(&doc->arena);
+    ason_context_release(&c);
+    return ret;
+}
+
+int ason_document_parse(ason_document* doc, const char* json) {
+    assert(json != NULL);
+    return ason_document_parse_ex(doc, json, strlen(json), 0);
+}
+
+ason_value* ason_document_root(ason_document* doc) {
+    assert(doc != NULL);
+    return &doc->root;
+}
+
+void ason_document_set_string(ason_document* doc, ason_value* v, const char* s, size_t len) {
+    assert(doc != NULL && v != NULL && (s != NULL || len == 0));
+    ason_free(v);
+    ason_value_set_string(v, s, len, &doc->arena);
+}
+
+/* NDJSON: the input is cut into one range of whole lines per worker, results are joined in order */
+typedef struct {
+    const char *begin, *end;
+    ason_value* values;
+    int* errors;
+    size_t* lines; /* within the range until joined */
+    size_t count, cap, nlines;
+#ifndef ASON_NO_THREADS
+    pthread_t thread;
+    int started;
+#endif
+} ason_ndjson_part;
+
+static void* ason_ndjson_worker(void* arg) {
+    ason_ndjson_part* part = (ason_ndjson_part*)arg;
+    const char *p = part->begin, *eol;
+    ason_context c;
+    /* one context per worker, its stack is reused by every line */
+    ason_context_init(&c, NULL, 0, 0);
+    while (p != part->end) {
+        if ((eol = (const char*)memchr(p, '\n', (size_t)(part->end - p))) == NULL)
+            eol = part->end;
+        part->nlines++;
+        c.json = p;
+        c.end = c.limit = eol;
+        ason_parse_whitespace(&c);
+        if (c.json != c.end) {
+            if (part->count == part->cap) {
+                part->cap = part->cap ? part->cap + (part->cap >> 1) : 64;
+                part->values = (ason_value*)ASON_REALLOC(part->values, part->cap * sizeof(ason_value));
+                part->errors = (int*)ASON_REALLOC(part->errors, part->cap * sizeof(int));
+                part->lines = (size_t*)ASON_REALLOC(part->lines, part->cap * sizeof(size_t));
+            }
+            ason_init(&part->values[part->count]);
+            part->errors[part->count] = ason_parse_root(&c, &part->values[part->count]);
+            part->lines[part->count] = part->nlines;
+            part->count++;
+        }
+        p = eol == part->end ? eol : eol + 1;
+    }
+    ASON_FREE(c.stack);
+    return NULL;
+}
+
+int ason_parse_ndjson(ason_ndjson* out, const char* json, size_t len, int nthreads) {
+    ason_ndjson_part* parts;
+    const char *end = json + len, *b;
+    size_t i, j, n, k, line = 0;
+    int ret = ASON_PARSE_OK;
+    assert(out != NULL && (json != NULL || len == 0));
+    n = len / ASON_NDJSON_MIN_PART + 1;
+    if (nthreads < 1)
+        nthreads = 1;
+    if (n > (size_t)nthreads)
+        n = (size_t)nthreads;
+    parts = (ason_ndjson_part*)ASON_CALLOC(n, sizeof(ason_ndjson_part));
+    for (i = 0, b = json; i < n; i++) {
+        parts[i].begin = b;
+        if (i + 1 == n)
+            b = end;
+        else if (b < json + len / n * (i + 1)) {
+            /* the next range starts after the first newline past this one's even share */
+            b = (const char*)memchr(json + len / n * (i + 1), '\n', len - len / n * (i + 1));
+            b = b ? b + 1 : end;
+        }
+        parts[i].end = b;
+    }
+#ifndef ASON_NO_THREADS
+    ason_scan_select(); /* before the workers race to do it */
+    for (i = 1; i < n; i++)
+        parts[i].started = pthread_create(&parts[i].thread, NULL, ason_ndjson_worker, &parts[i]) == 0;
+    ason_ndjson_worker(&parts[0]);
+    for (i = 1; i < n; i++) {
+        if (parts[i].started)
+            pthread_join(parts[i].thread, NULL);
+        else
+            ason_ndjson_worker(&parts[i]);
+    }
+#else
+    for (i = 0; i < n; i++)
+        ason_ndjson_worker(&parts[i]);
+#endif
+    for (i = 0, out->count = 0; i < n; i++)
+        out->count += parts[i].count;
+    out->values = (ason_value*)ASON_MALLOC(out->count * sizeof(ason_value) + 1);
+    out->errors = (int*)ASON_MALLOC(out->count * sizeof(int) + 1);
+    out->lines = (size_t*)ASON_MALLOC(out->count * sizeof(size_t) + 1);
+    for (i = 0, k = 0; i < n; k += parts[i].count, line += parts[i].nlines, i++) {
+        if (parts[i].count > 0) {
+            memcpy(out->values + k, parts[i].values, parts[i].count * sizeof(ason_value));
+            memcpy(out->errors + k, parts[i].errors, parts[i].count * sizeof(int));
+        }
+        for (j = 0; j < parts[i].count; j++) {
+            out->lines[k + j] = line + parts[i].lines[j];
+            if (ret == ASON_PARSE_OK)
+                ret = parts[i].errors[j];
+        }
+        ASON_FREE(parts[i].values);
+        ASON_FREE(parts[i].errors);
+        ASON_FREE(parts[i].lines);
+    }
+    ASON_FREE(parts);
+    return ret;
+}
+
+void ason_ndjson_free(ason_ndjson* r) {
+    size_t i;
+    assert(r != NULL);
+    for (i = 0; i < r->count; i++)
+        ason_free(&r->values[i]);
+    ASON_FREE(r->values);
+    ASON_FREE(r->errors);
+    ASON_FREE(r->lines);
+    r->values = NULL;
+    r->errors = NULL;
+    r->lines = NULL;
+    r->count = 0;
+}
+
+/*
+ * On-demand access. Stage 1 classifies the input 64 bytes at a time and records
+ * the position of every structural character, opening quote and scalar start
+ * outside strings. Accessors then walk that index and only decode what they touch,
+ * so errors in parts of the document that are never visited go unnoticed.
+ */
+struct ason_ondemand_doc {
+    ason_context c; /* scratch stack for decoded strings */
+    ason_arena strings; /* escaped strings handed out by get_string, until the next parse */
+    const char* json;
+    size_t len;
+    uint32_t* index;
+    size_t count, cap; /* index[count] is len */
+};
+
+/* bits of backslash-escaped bytes, *carry tells whether the first byte of the next block is escaped */
+static uint64_t ason_escaped(uint64_t backslash, uint64_t* carry) {
+    const uint64_t even = ASON_UINT64_C2(0x55555555, 0x55555555);
+    uint64_t follows, odd_starts, sum;
+    backslash &= ~*carry;
+    follows = backslash << 1 | *carry;
+    /* adding the starts of odd-aligned runs carries through them, which flips their parity */
+    odd_starts = backslash & ~even & ~follows;
+    sum = odd_starts + backslash;
+    *carry = sum < odd_starts;
+    return (even ^ (sum << 1)) & follows;
+}
+
+/* bit i is the xor of bits 0..i */
+static uint64_t ason_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static int ason_ondemand_index(ason_ondemand_doc* d) {
+    uint64_t escaped_carry = 0, in_string_carry = 0, scalar_carry = 0;
+    uint64_t quote, in_string, scalar, follows_scalar, structural;
+    ason_block b;
+    char tail[64];
+    size_t base, n = 0;
+    if (d->cap < d->len + 1) {
+        d->cap = d->len + 1;
+        d->index = (uint32_t*)ASON_REALLOC(d->index, d->cap * sizeof(uint32_t));
+    }
+    for (base = 0; base < d->len; base += 64) {
+        if (d->len - base >= 64)
+            ason_classify(d->json + base, &b);
+        else {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, d->json + base, d->len - base);
+            ason_classify(tail, &b);
+        }
+        quote = b.quote & ~ason_escaped(b.backslash, &escaped_carry);
+        in_string = ason_prefix_xor(quote) ^ in_string_carry; /* opening quote in, closing quote out */
+        in_string_carry = (uint64_t)0 - (in_string >> 63);
+        scalar = ~(b.op | b.ws);
+        follows_scalar = (scalar & ~b.quote) << 1 | scalar_carry;
+        scalar_carry = (scalar & ~b.quote) >> 63;
+        structural = (b.op | (scalar & ~follows_scalar)) & ~(in_string ^ quote);
+        while (structural) {
+            d->index[n++] = (uint32_t)(base + (size_t)__builtin_ctzll(structural));
+            structural &= structural - 1;
+        }
+    }
+    d->count = n;
+    d->index[n] = (uint32_t)d->len;
+    return in_string_carry ? ASON_PARSE_MISS_QUOTATION_MARK : ASON_PARSE_OK;
+}
+
+#define ASON_OD_CHAR(d, i) ((i) < (d)->count ? (d)->json[(d)->index[i]] : '\0')
+
+/* the index entry after the value at i, i itself when there is no value */
+static size_t ason_ondemand_skip(const ason_ondemand_doc* d, size_t i) {
+    size_t depth = 0;
+    do {
+        switch (ASON_OD_CHAR(d, i)) {
+            case '[': case '{': depth++; break;
+            case ']': case '}':
+                if (depth-- == 0)
+                    return i;
+                break;
+            case ',': case ':': case '\0':
+                if (depth == 0)
+                    return i;
+                break;
+        }
+        i++;
+    } while (depth > 0 && i <= d->count);
+    return i;
+}
+
+ason_ondemand_doc* ason_ondemand_create(void) {
+    ason_ondemand_doc* d = (ason_ondemand_doc*)ASON_MALLOC(sizeof(ason_ondemand_doc));
+    ason_context_init(&d->c, NULL, 0, 0);
+    ason_arena_init(&d->strings, &ason_global_allocator);
+    d->json = NULL;
+    d->len = d->count = d->cap = 0;
+    d->index = NULL;
+    return d;
+}
+
+void ason_ondemand_free(ason_ondemand_doc* d) {
+    if (d == NULL)
+        return;
+    ASON_FREE(d->c.stack);
+    ASON_FREE(d->index);
+    ason_arena_release(&d->strings);
+    ASON_FREE(d);
+}
+
+int ason_ondemand_parse(ason_ondemand_doc* d, const char* json, size_t len) {
+    size_t end;
+    int ret;
+    assert(d != NULL && (json != NULL || len == 0));
+    d->json = json;
+    d->len = len;
+    d->count = 0;
+    ason_arena_reset(&d->strings);
+    if ((uint32_t)len != len)
+        return ASON_PARSE_INVALID_VALUE; /* positions are 32-bit */
+    if ((ret = ason_ondemand_index(d)) != ASON_PARSE_OK)
+        return ret;
+    if (d->count == 0)
+        return ASON_PARSE_EXPECT_VALUE;
+    if ((end = ason_ondemand_skip(d, 0)) == 0)
+        return ASON_PARSE_INVALID_VALUE;
+    if (end > d->count)
+        return d->json[d->index[0]] == '[' ? ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    if (end != d->count)
+        return ASON_PARSE_ROOT_NOT_SINGULAR;
+    return ASON_PARSE_OK;
+}
+
+void ason_ondemand_root(ason_ondemand_doc* d, ason_ondemand_value* v) {
+    assert(d != NULL && v != NULL);
+    v->doc = d;
+    v->i = 0;
+}
+
+ason_type ason_ondemand_get_type(const ason_ondemand_value* v) {
+    assert(v != NULL);
+    switch (ASON_OD_CHAR(v->doc, v->i)) {
+        case '{': return ASON_OBJECT;
+        case '[': return ASON_ARRAY;
+        case '"': return ASON_STRING;
+        case 't': return ASON_TRUE;
+        case 'f': return ASON_FALSE;
+        case 'n': return ASON_NULL;
+        default : return ASON_NUMBER;
+    }
+}
+
+/* decodes the string at index entry i, into the scratch stack when it has escapes */
+static int ason_ondemand_string(ason_ondemand_doc* d, size_t i, const char** s, size_t* len) {
+    d->c.json = d->json + d->index[i];
+    d->c.end = d->c.limit = d->json + d->len;
+    d->c.top = 0;
+    return ason_parse_string_raw(&d->c, s, len);
+}
+
+int ason_ondemand_find_field(const ason_ondemand_value* obj, const char* key, size_t klen, ason_ondemand_value* out) {
+    ason_ondemand_doc* d;
+    const char* s;
+    size_t i, j, len;
+    assert(obj != NULL && out != NULL && (key != NULL || klen == 0));
+    d = obj->doc;
+    i = obj->i;
+    if (ASON_OD_CHAR(d, i) != '{')
+        return ASON_PARSE_INCORRECT_TYPE;
+    if (ASON_OD_CHAR(d, i + 1) == '}')
+        return ASON_PARSE_NOT_FOUND;
+    while (1) {
+        i++;
+        if (ASON_OD_CHAR(d, i) != '"' || ason_ondemand_string(d, i, &s, &len) != ASON_PARSE_OK)
+            return ASON_PARSE_MISS_KEY;
+        if (ASON_OD_CHAR(d, i + 1) != ':')
+            return ASON_PARSE_MISS_COLON;
+        i += 2;
+        if (len == klen && memcmp(s, key, klen) == 0) {
+            out->doc = d;
+            out->i = i;
+            return ASON_PARSE_OK;
+        }
+        if ((j = ason_ondemand_skip(d, i)) == i)
+            return i == d->count ? ASON_PARSE_EXPECT_VALUE : ASON_PARSE_INVALID_VALUE;
+        i = j;
+        switch (ASON_OD_CHAR(d, i)) {
+            case ',': break;
+            case '}': return ASON_PARSE_NOT_FOUND;
+            default : return ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        }
+    }
+}
+
+int ason_ondemand_array_iter(const ason_ondemand_value* arr, ason_ondemand_iter* it) {
+    assert(arr != NULL && it != NULL);
+    if (ASON_OD_CHAR(arr->doc, arr->i) != '[')
+        return ASON_PARSE_INCORRECT_TYPE;
+    it->doc = arr->doc;
+    it->i = arr->i + 1;
+    it->started = 0;
+    return ASON_PARSE_OK;
+}
+
+int ason_ondemand_next(ason_ondemand_iter* it, ason_ondemand_value* out) {
+    ason_ondemand_doc* d;
+    size_t i, j;
+    assert(it != NULL && out != NULL);
+    d = it->doc;
+    i = it->i;
+    if (!it->started) {
+        it->started = 1;
+        if (ASON_OD_CHAR(d, i) == ']')
+            return ASON_PARSE_NOT_FOUND;
+    }
+    else
+        switch (ASON_OD_CHAR(d, i)) {
+            case ',': i++; break;
+            case ']': return ASON_PARSE_NOT_FOUND;
+            default : return ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        }
+    if ((j = ason_ondemand_skip(d, i)) == i)
+        return i == d->count ? ASON_PARSE_EXPECT_VALUE : ASON_PARSE_INVALID_VALUE;
+    out->doc = d;
+    out->i = i;
+    it->i = j;
+    return ASON_PARSE_OK;
+}
+
+int ason_ondemand_get_value(const ason_ondemand_value* v, ason_value* out) {
+    ason_ondemand_doc* d;
+    size_t j;
+    int ret;
+    assert(v != NULL && out != NULL);
+    d = v->doc;
+    ason_init(out);
+    if (v->i >= d->count)
+        return ASON_PARSE_EXPECT_VALUE;
+    d->c.json = d->json + d->index[v->i];
+    d->c.end = d->c.limit = d->json + d->len;
+    d->c.top = 0;
+    if ((ret = ason_parse_value(&d->c, out)) != ASON_PARSE_OK)
+        return ret;
+    /* the value has to end where the index says it does */
+    ason_parse_whitespace(&d->c);
+    j = ason_ondemand_skip(d, v->i);
+    if (j > d->count || d->c.json != d->json + d->index[j]) {
+        ason_free(out);
+        return ASON_PARSE_INVALID_VALUE;
+    }
+    return ASON_PARSE_OK;
+}
+
+int ason_ondemand_get_double(const ason_ondemand_value* v, double* n) {
+    ason_value tmp;
+    int ret;
+    assert(v != NULL && n != NULL);
+    if (ason_ondemand_get_type(v) != ASON_NUMBER)
+        return ASON_PARSE_INCORRECT_TYPE;
+    if ((ret = ason_ondemand_get_value(v, &tmp)) == ASON_PARSE_OK)
+        *n = ason_get_number(&tmp);
+    return ret;
+}
+
+int ason_ondemand_get_string(const ason_ondemand_value* v, const char** s, size_t* len) {
+    ason_ondemand_doc* d;
+    char* p;
+    int ret;
+    assert(v != NULL && s != NULL && len != NULL);
+    d = v->doc;
+    if (ason_ondemand_get_type(v) != ASON_STRING)
+        return ASON_PARSE_INCORRECT_TYPE;
+    if ((ret = ason_ondemand_string(d, v->i, s, len)) != ASON_PARSE_OK || d->c.top == 0)
+        return ret;
+    /* decoded on the scratch stack, which the next key or value reuses */
+    p = (char*)ason_arena_alloc(&d->strings, *len + 1);
+    memcpy(p, *s, *len);
+    p[*len] = '\0';
+    *s = p;
+    return ASON_PARSE_OK;
+}
+
+#ifndef ASON_STRINGIFY_INIT_SIZE
+#define ASON_STRINGIFY_INIT_SIZE 256
+#endif
+
+/* Grisu2 shortest round-trip double formatting (after Florian Loitsch and miloyip's dtoa). */
+
+static void ason_grisu_round(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int ason_count_digits32(uint32_t n) {
+    int d = 1;
+    while (n >= 10) {
+        n /= 10;
+        d++;
+    }
+    return d;
+}
+
+static void ason_digit_gen(ason_diyfp W, ason_diyfp Mp, uint64_t delta, char* buffer, int* len, int* K) {
+    const int shift = -Mp.e;
+    const uint64_t one = (uint64_t)1 << shift;
+    const uint64_t wp_w = Mp.f - W.f;
+    uint32_t p1 = (uint32_t)(Mp.f >> shift);
+    uint64_t p2 = Mp.f & (one - 1);
+    int kappa = ason_count_digits32(p1);
+    *len = 0;
+    while (kappa > 0) {
+        uint32_t d = p1 / (uint32_t)ason_pow10[kappa - 1];
+        uint64_t tmp;
+        p1 %= (uint32_t)ason_pow10[kappa - 1];
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        kappa--;
+        tmp = ((uint64_t)p1 << shift) + p2;
+        if (tmp <= delta) {
+            *K += kappa;
+            ason_grisu_round(buffer, *len, delta, tmp, ason_pow10[kappa] << shift, wp_w);
+            return;
+        }
+    }
+    for (;;) {
+        char d;
+        p2 *= 10;
+        delta *= 10;
+        d = (char)(p2 >> shift);
+        if (d || *len)
+            buffer[(*len)++] = (char)('0' + d);
+        p2 &= one - 1;
+        kappa--;
+        if (p2 < delta) {
+            *K += kappa;
+            ason_grisu_round(buffer, *len, delta, p2, one, wp_w * (-kappa < 20 ? ason_pow10[-kappa] : 0));
+            return;
+        }
+    }
+}
+
+static void ason_grisu2(double value, char* buffer, int* length, int* K) {
+    ason_diyfp v = ason_diyfp_from_double(value), w_m, w_p, c_mk, W, Wp, Wm;
+    ason_diyfp_boundaries(v, &w_m, &w_p);
+    c_mk = ason_cached_power(w_p.e, K);
+    W  = ason_diyfp_mul(ason_diyfp_normalize(v), c_mk);
+    Wp = ason_diyfp_mul(w_p, c_mk);
+    Wm = ason_diyfp_mul(w_m, c_mk);
+    Wm.f++;
+    Wp.f--;
+    ason_digit_gen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+static char* ason_write_exponent(int K, char* buffer) {
+    if (K < 0) {
+        *buffer++ = '-';
+        K = -K;
+    }
+    if (K >= 100) {
+        *buffer++ = (char)('0' + K / 100);
+        K %= 100;
+        *buffer++ = (char)('0' + K / 10);
+    }
+    else if (K >= 10)
+        *buffer++ = (char)('0' + K / 10);
+    *buffer++ = (char)('0' + K % 10);
+    return buffer;
+}
+
+static char* ason_prettify(char* buffer, int length, int k) {
+    const int kk = length + k; /* 10^(kk-1) <= v < 10^kk */
+    int i;
+    if (0 <= k && kk <= 21) {
+        /* 1234e7 -> 12340000000.0 */
+        for (i = length; i < kk; i++)
+            buffer[i] = '0';
+        buffer[kk] = '.';
+        buffer[kk + 1] = '0';
+        return &buffer[kk + 2];
+    }
+    else if (0 < kk && kk <= 21) {
+        /* 1234e-2 -> 12.34 */
+        memmove(&buffer[kk + 1], &buffer[kk], (size_t)(length - kk));
+        buffer[kk] = '.';
+        return &buffer[length + 1];
+    }
+    else if (-6 < kk && kk <= 0) {
+        /* 1234e-6 -> 0.001234 */
+        const int offset = 2 - kk;
+        memmove(&buffer[offset], &buffer[0], (size_t)length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        for (i = 2; i < offset; i++)
+            buffer[i] = '0';
+        return &buffer[length + offset];
+    }
+    else if (length == 1) {
+        /* 1e30 */
+        buffer[1] = 'e';
+        return ason_write_exponent(kk - 1, &buffer[2]);
+    }
+    else {
+        /* 1234e30 -> 1.234e33 */
+        memmove(&buffer[2], &buffer[1], (size_t)(length - 1));
+        buffer[1] = '.';
+        buffer[length + 1] = 'e';
+        return ason_write_exponent(kk - 1, &buffer[length + 2]);
+    }
+}
+
+/* writes at most 25 chars, returns the end of the written text */
+static char* ason_dtoa(double value, char* buffer) {
+    int length, K;
+    if (value == 0.0) {
+        if (1.0 / value < 0)
+            *buffer++ = '-';
+        buffer[0] = '0';
+        buffer[1] = '.';
+        buffer[2] = '0';
+        return &buffer[3];
+    }
+    if (value != value || value - value != 0.0) {
+        /* NaN and infinity have no JSON representation */
+        memcpy(buffer, "null", 4);
+        return &buffer[4];
+    }
+    if (value < 0) {
+        *buffer++ = '-';
+        value = -value;
+    }
+    ason_grisu2(value, buffer, &length, &K);
+    return ason_prettify(buffer, length, K);
+}
+
+#define PUTC(c, ch) do { *(char*)ason_context_push(c, sizeof(char)) = (ch);} while(0)
+#define PUTS(c, s, len) memcpy(ason_context_push(c, len), s, len)
+
+static void ason_stringify_number(ason_context* c, double d) {
+    char* buffer = (char*)ason_context_push(c, 32);
+    c->top -= 32 - (size_t)(ason_dtoa(d, buffer) - buffer);
+}
+
+static char* ason_itoa(int64_t i, char* buffer) {
+    char digits[20], *p = digits + sizeof(digits);
+    uint64_t u = i < 0 ? (uint64_t)0 - (uint64_t)i : (uint64_t)i;
+    do *--p = (char)('0' + u % 10); while (u /= 10);
+    if (i < 0)
+        *buffer++ = '-';
+    memcpy(buffer, p, (size_t)(digits + sizeof(digits) - p));
+    return buffer + (digits + sizeof(digits) - p);
+}
+
+static void ason_stringify_integer(ason_context* c, int64_t i) {
+    char* buffer = (char*)ason_context_push(c, 21);
+    c->top -= 21 - (size_t)(ason_itoa(i, buffer) - buffer);
+}
+
+static void ason_stringify_string(ason_context* c, const char* s, size_t len) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    size_t i = 0, run;
+    char* p;
+    PUTC(c, '"');
+    while (i < len) {
+        /* copy the longest run that needs no escaping in one go */
+        run = (size_t)(ason_scan_string(s + i, s + len) - s);
+        if (run > i) {
+            PUTS(c, s + i, run - i);
+            i = run;
+        }
+        if (i < len) {
+            unsigned char ch = (unsigned char)s[i++];
+            if (ason_escape[ch] == 'u') {
+                p = (char*)ason_context_push(c, 6);
+                p[0] = '\\'; p[1] = 'u'; p[2] = '0'; p[3] = '0';
+                p[4] = hex_digits[ch >> 4];
+                p[5] = hex_digits[ch & 15];
+            }
+            else {
+                p = (char*)ason_context_push(c, 2);
+                p[0] = '\\';
+                p[1] = ason_escape[ch];
+            }
+        }
+    }
+    PUTC(c, '"');
+}
+
+static void ason_stringify_value(ason_context* c, const ason_value* v) {
+    size_t i;
+    switch (v->type) {
+        case ASON_NULL:   PUTS(c, "null",  4); break;
+        case ASON_FALSE:  PUTS(c, "false", 5); break;
+        case ASON_TRUE:   PUTS(c, "true",  4); break;
+        case ASON_NUMBER:
+            if (v->flags & ASON_F_RAW)
+                PUTS(c, v->u.s, ASON_SIZE(v));
+            else if (v->flags & ASON_F_INTEGER)
+                ason_stringify_integer(c, v->u.num.i);
+            else
+                ason_stringify_number(c, v->u.num.d);
+            break;
+        case ASON_STRING: ason_stringify_string(c, ASON_STR(v), ASON_STR_LEN(v)); break;
+        case ASON_ARRAY:
+            PUTC(c, '[');
+            for (i = 0; i < ASON_SIZE(v); i++) {
+                if (i > 0)
+                    PUTC(c, ',');
+                ason_stringify_value(c, &v->u.m[i]);
+            }
+            PUTC(c, ']');
+            break;
+        case ASON_OBJECT:
+            PUTC(c, '{');
+            for (i = 0; i < ASON_SIZE(v); i++) {
+                if (i > 0)
+                    PUTC(c, ',');
+                ason_stringify_string(c, v->u.e[i].k.s, v->u.e[i].k.len);
+                PUTC(c, ':');
+                ason_stringify_value(c, &v->u.e[i].v);
+            }
+            PUTC(c, '}');
+            break;
+        default: assert(0 && "invalid type");
+    }
+}
+
+size_t ason_stringify_buffer(const ason_value* v, char** buffer, size_t* capacity) {
+    ason_context c;
+    assert(v != NULL && buffer != NULL && capacity != NULL);
+    c.stack = *buffer;
+    c.size = *capacity;
+    c.top = 0;
+    c.alloc = &ason_global_allocator;
+    if (c.size == 0)
+        c.stack = (char*)ASON_REALLOC(c.stack, c.size = ASON_STRINGIFY_INIT_SIZE);
+    ason_stringify_value(&c, v);
+    c.stack[c.top] = '\0'; /* push always leaves one spare byte */
+    *buffer = c.stack;
+    *capacity = c.size;
+    return c.top;
+}
+
+char* ason_stringify(const ason_value* v, size_t* length) {
+    char* buffer = NULL;
+    size_t capacity = 0, len;
+    len = ason_stringify_buffer(v, &buffer, &capacity);
+    if (length)
+        *length = len;
+    return buffer;
+}
+
+#ifndef ASON_WRITER_BUFFER_SIZE
+#define ASON_WRITER_BUFFER_SIZE (1 << 16)
+#endif
+
+#ifndef ASON_WRITER_DIRECT_MIN
+#define ASON_WRITER_DIRECT_MIN 1024 /* longer spans that do not fit go out with the buffer, uncopied */
+#endif
+
+struct ason_writer {
+    ason_write_func write_fn;
+    void* user;
+    int fd;
+    int error;
+    int first;            /* nothing written yet at this level */
+    int key;              /* a key is waiting for its value */
+    size_t depth, len;
+    unsigned char stack[ASON_PARSE_MAX_DEPTH]; /* '[' or '{' per open container */
+    char buffer[ASON_WRITER_BUFFER_SIZE];
+};
+
+static ason_writer* ason_writer_new(ason_write_func write_fn, void* user, int fd) {
+    ason_writer* w = (ason_writer*)ASON_MALLOC(sizeof(ason_writer));
+    w->write_fn = write_fn;
+    w->user = user;
+    w->fd = fd;
+    w->error = ASON_PARSE_OK;
+    w->first = 1;
+    w->key = 0;
+    w->depth = w->len = 0;
+    return w;
+}
+
+ason_writer* ason_writer_create(ason_write_func write_fn, void* user) {
+    assert(write_fn != NULL);
+    return ason_writer_new(write_fn, user, -1);
+}
+
+#ifndef ASON_NO_WRITEV
+ason_writer* ason_writer_create_fd(int fd) {
+    assert(fd >= 0);
+    return ason_writer_new(NULL, NULL, fd);
+}
+#endif
+
+void ason_writer_destroy(ason_writer* w) {
+    ASON_FREE(w);
+}
+
+/* writes the buffer and then s, in one writev for an fd */
+static void ason_writer_output(ason_writer* w, const char* s, size_t n) {
+#ifndef ASON_NO_WRITEV
+    if (w->write_fn == NULL) {
+        struct iovec iov[2], *v = iov;
+        int count = 0;
+        ssize_t r;
+        if (w->len > 0) {
+            iov[count].iov_base = w->buffer;
+            iov[count++].iov_len = w->len;
+        }
+        if (n > 0) {
+            iov[count].iov_base = (void*)s;
+            iov[count++].iov_len = n;
+        }
+        while (count > 0) {
+            if ((r = writev(w->fd, v, count)) < 0) {
+                if (errno == EINTR)
+                    continue;
+                w->error = ASON_PARSE_ABORTED;
+                break;
+            }
+            /* partial writes resume where they stopped */
+            while (count > 0 && (size_t)r >= v->iov_len) {
+                r -= (ssize_t)v->iov_len;
+                v++;
+                count--;
+            }
+            if (count > 0) {
+                v->iov_base = (char*)v->iov_base + r;
+                v->iov_len -= (size_t)r;
+            }
+        }
+        w->len = 0;
+        return;
+    }
+#endif
+    if ((w->len > 0 && !w->write_fn(w->user, w->buffer, w->len)) ||
+        (n > 0 && !w->write_fn(w->user, s, n)))
+        w->error = ASON_PARSE_ABORTED;
+    w->len = 0;
+}
+
+static char* ason_writer_reserve(ason_writer* w, size_t n) {
+    assert(n <= ASON_WRITER_BUFFER_SIZE);
+    if (w->len + n > ASON_WRITER_BUFFER_SIZE)
+        ason_writer_output(w, NULL, 0);
+    return w->buffer + w->len;
+}
+
+static void ason_writer_puts(ason_writer* w, const char* s, size_t n) {
+    if (w->len + n <= ASON_WRITER_BUFFER_SIZE) {
+        memcpy(w->buffer + w->len, s, n);
+        w->len += n;
+    }
+    else if (n >= ASON_WRITER_DIRECT_MIN)
+        ason_writer_output(w, s, n);
+    else {
+        ason_writer_output(w, NULL, 0);
+        memcpy(w->buffer, s, n);
+        w->len = n;
+    }
+}
+
+#define WPUTC(w, ch) do { *ason_writer_reserve(w, 1) = (ch); (w)->len++; } while(0)
+
+static void ason_writer_escape(ason_writer* w, const char* s, size_t len) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    size_t i = 0, run;
+    char* p;
+    WPUTC(w, '"');
+    while (i < len) {
+        run = (size_t)(ason_scan_string(s + i, s + len) - s);
+        if (run > i) {
+            ason_writer_puts(w, s + i, run - i);
+            i = run;
+        }
+        if (i < len) {
+            unsigned char ch = (unsigned char)s[i++];
+            p = ason_writer_reserve(w, 6);
+            p[0] = '\\';
+            if (ason_escape[ch] == 'u') {
+                p[1] = 'u'; p[2] = '0'; p[3] = '0';
+                p[4] = hex_digits[ch >> 4];
+                p[5] = hex_digits[ch & 15];
+                w->len += 6;
+            }
+            else {
+                p[1] = ason_escape[ch];
+                w->len += 2;
+            }
+        }
+    }
+    WPUTC(w, '"');
+}
+
+/* the separator before a value, or an error when a value is out of place */
+static int ason_writer_value(ason_writer* w) {
+    if (w->error != ASON_PARSE_OK)
+        return w->error;
+    if (w->depth == 0) {
+        if (!w->first)
+            WPUTC(w, '\n');
+    }
+    else if (w->stack[w->depth - 1] == '{') {
+        if (!w->key)
+            return w->error = ASON_PARSE_INCORRECT_TYPE;
+    }
+    else if (!w->first)
+        WPUTC(w, ',');
+    w->first = w->key = 0;
+    return ASON_PARSE_OK;
+}
+
+static int ason_writer_start(ason_writer* w, char ch) {
+    int ret;
+    if ((ret = ason_writer_value(w)) != ASON_PARSE_OK)
+        return ret;
+    if (w->depth == ASON_PARSE_MAX_DEPTH)
+        return w->error = ASON_PARSE_DEPTH_EXCEEDED;
+    w->stack[w->depth++] = (unsigned char)ch;
+    w->first = 1;
+    WPUTC(w, ch);
+    return w->error;
+}
+
+static int ason_writer_end(ason_writer* w, char open, char close) {
+    if (w->error != ASON_PARSE_OK)
+        return w->error;
+    if (w->depth == 0 || w->stack[w->depth - 1] != open || w->key)
+        return w->error = ASON_PARSE_INCORRECT_TYPE;
+    w->depth--;
+    w->first = 0;
+    WPUTC(w, close);
+    return w->error;
+}
+
+int ason_writer_start_object(ason_writer* w) {
+    return ason_writer_start(w, '{');
+}
+
+int ason_writer_end_object(ason_writer* w) {
+    return ason_writer_end(w, '{', '}');
+}
+
+int ason_writer_start_array(ason_writer* w) {
+    return ason_writer_start(w, '[');
+}
+
+int ason_writer_end_array(ason_writer* w) {
+    return ason_writer_end(w, '[', ']');
+}
+
+int ason_writer_key(ason_writer* w, const char* s, size_t len) {
+    assert(s != NULL || len == 0);
+    if (w->error != ASON_PARSE_OK)
+        return w->error;
+    if (w->depth == 0 || w->stack[w->depth - 1] != '{' || w->key)
+        return w->error = ASON_PARSE_INCORRECT_TYPE;
+    if (!w->first)
+        WPUTC(w, ',');
+    ason_writer_escape(w, s, len);
+    WPUTC(w, ':');
+    w->key = 1;
+    return w->error;
+}
+
+int ason_writer_null(ason_writer* w) {
+    return ason_writer_raw(w, "null", 4);
+}
+
+int ason_writer_boolean(ason_writer* w, int b) {
+    return b ? ason_writer_raw(w, "true", 4) : ason_writer_raw(w, "false", 5);
+}
+
+int ason_writer_number(ason_writer* w, double d) {
+    char* p;
+    int ret;
+    if ((ret = ason_writer_value(w)) != ASON_PARSE_OK)
+        return ret;
+    p = ason_writer_reserve(w, 32);
+    w->len += (size_t)(ason_dtoa(d, p) - p);
+    return w->error;
+}
+
+int ason_writer_int(ason_writer* w, int64_t i) {
+    char* p;
+    int ret;
+    if ((ret = ason_writer_value(w)) != ASON_PARSE_OK)
+        return ret;
+    p = ason_writer_reserve(w, 21);
+    w->len += (size_t)(ason_itoa(i, p) - p);
+    return w->error;
+}
+
+int ason_writer_string(ason_writer* w, const char* s, size_t len) {
+    int ret;
+    assert(s != NULL || len == 0);
+    if ((ret = ason_writer_value(w)) != ASON_PARSE_OK)
+        return ret;
+    ason_writer_escape(w, s, len);
+    return w->error;
+}
+
+int ason_writer_raw(ason_writer* w, const char* json, size_t len) {
+    int ret;
+    assert(json != NULL || len == 0);
+    if ((ret = ason_writer_value(w)) != ASON_PARSE_OK)
+        return ret;
+    ason_writer_puts(w, json, len);
+    return w->error;
+}
+
+int ason_writer_flush(ason_writer* w) {
+    if (w->len > 0)
+        ason_writer_output(w, NULL, 0);
+    return w->error;
+}
+
+int ason_writer_finish(ason_writer* w) {
+    int ret = ason_writer_flush(w);
+    if (ret == ASON_PARSE_OK && w->depth > 0)
+        ret = ASON_PARSE_INCORRECT_TYPE;
+    w->error = ASON_PARSE_OK;
+    w->first = 1;
+    w->key = 0;
+    w->depth = w->len = 0;
+    return ret;
+}
+
+/*
+ * ASON binary: "ASB" 1, u32 size of the whole buffer, root node. Integers are little-endian.
+ * A node is a tag (ason_type, or ASON_BIN_INTEGER) and then
+ *   number: 8-byte double or int64
+ *   string: u32 length, bytes, '\0'
+ *   array:  u32 count, u32 offset of each element from the tag, the elements
+ *   object: u32 count, u32 offset of each entry, u32 entry indices in key order, the entries
+ *   entry:  key as a string without tag, value node
+ */
+#define ASON_BIN_INTEGER 7
+#define ASON_BIN_HEADER 8
+
+static void ason_bin_put32(unsigned char* p, uint32_t n) {
+    p[0] = (unsigned char)n;
+    p[1] = (unsigned char)(n >> 8);
+    p[2] = (unsigned char)(n >> 16);
+    p[3] = (unsigned char)(n >> 24);
+}
+
+static uint32_t ason_bin_get32(const unsigned char* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void ason_bin_put_string(ason_context* c, const char* s, size_t len) {
+    unsigned char* p = (unsigned char*)ason_context_push(c, 4 + len + 1);
+    ason_bin_put32(p, (uint32_t)len);
+    memcpy(p + 4, s, len);
+    p[4 + len] = '\0';
+}
+
+/* keys compare bytewise, a prefix first; equal keys keep their order */
+static int ason_bin_compare(const char* a, size_t alen, const char* b, size_t blen) {
+    int r = memcmp(a, b, alen < blen ? alen : blen);
+    return r != 0 ? r : (alen > blen) - (alen < blen);
+}
+
+typedef struct {
+    const ason_string* k;
+    uint32_t i;
+} ason_bin_key;
+
+static int ason_bin_key_compare(const void* a, const void* b) {
+    const ason_bin_key* x = (const ason_bin_key*)a;
+    const ason_bin_key* y = (const ason_bin_key*)b;
+    int r = ason_bin_compare(x->k->s, x->k->len, y->k->s, y->k->len);
+    return r != 0 ? r : (x->i > y->i) - (x->i < y->i);
+}
+
+static void ason_bin_encode(ason_context* c, const ason_value* v) {
+    ason_value tmp;
+    size_t i, n, node = c->top;
+    ason_bin_key* keys;
+    unsigned char* p;
+    uint64_t bits;
+    switch (v->type) {
+        case ASON_NUMBER:
+            v = ason_number_value(v, &tmp);
+            p = (unsigned char*)ason_context_push(c, 9);
+            p[0] = v->flags & ASON_F_INTEGER ? ASON_BIN_INTEGER : ASON_NUMBER;
+            memcpy(&bits, &v->u.num, 8);
+            for (i = 0; i < 8; i++)
+                p[1 + i] = (unsigned char)(bits >> (i * 8));
+            break;
+        case ASON_STRING:
+            PUTC(c, ASON_STRING);
+            ason_bin_put_string(c, ASON_STR(v), ASON_STR_LEN(v));
+            break;
+        case ASON_ARRAY:
+            n = ASON_SIZE(v);
+            p = (unsigned char*)ason_context_push(c, 5 + n * 4);
+            p[0] = ASON_ARRAY;
+            ason_bin_put32(p + 1, (uint32_t)n);
+            for (i = 0; i < n; i++) {
+                ason_bin_put32((unsigned char*)c->stack + node + 5 + i * 4, (uint32_t)(c->top - node));
+                ason_bin_encode(c, &v->u.m[i]);
+            }
+            break;
+        case ASON_OBJECT:
+            n = ASON_SIZE(v);
+            p = (unsigned char*)ason_context_push(c, 5 + n * 8);
+            p[0] = ASON_OBJECT;
+            ason_bin_put32(p + 1, (uint32_t)n);
+            if (n == 0)
+                break;
+            keys = (ason_bin_key*)ASON_MALLOC(n * sizeof(ason_bin_key));
+            for (i = 0; i < n; i++) {
+                ason_bin_put32((unsigned char*)c->stack + node + 5 + i * 4, (uint32_t)(c->top - node));
+                ason_bin_put_string(c, v->u.e[i].k.s, v->u.e[i].k.len);
+                ason_bin_encode(c, &v->u.e[i].v);
+                keys[i].k = &v->u.e[i].k;
+                keys[i].i = (uint32_t)i;
+            }
+            qsort(keys, n, sizeof(ason_bin_key), ason_bin_key_compare);
+            for (i = 0; i < n; i++)
+                ason_bin_put32((unsigned char*)c->stack + node + 5 + (n + i) * 4, keys[i].i);
+            ASON_FREE(keys);
+            break;
+        default:
+            PUTC(c, (char)v->type);
+            break;
+    }
+}
+
+char* ason_encode_binary(const ason_value* v, size_t* length) {
+    ason_context c;
+    assert(v != NULL);
+    ason_context_init(&c, NULL, 0, 0);
+    memcpy(ason_context_push(&c, ASON_BIN_HEADER), "ASB\1\0\0\0\0", ASON_BIN_HEADER);
+    ason_bin_encode(&c, v);
+    if (c.top > 0xFFFFFFFFu) {
+        ASON_FREE(c.stack);
+        return NULL;
+    }
+    ason_bin_put32((unsigned char*)c.stack + 4, (uint32_t)c.top);
+    if (length)
+        *length = c.top;
+    return c.stack;
+}
+
+int ason_binary_open(ason_binary_view* root, const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    assert(root != NULL && (data != NULL || length == 0));
+    root->p = NULL;
+    if (length <= ASON_BIN_HEADER || memcmp(p, "ASB\1", 4) != 0 || ason_bin_get32(p + 4) > length)
+        return ASON_PARSE_INVALID_VALUE;
+    root->p = p + ASON_BIN_HEADER;
+    return ASON_PARSE_OK;
+}
+
+ason_type ason_binary_get_type(const ason_binary_view* v) {
+    assert(v != NULL && v->p != NULL);
+    return *v->p == ASON_BIN_INTEGER ? ASON_NUMBER : (ason_type)*v->p;
+}
+
+int ason_binary_is_integer(const ason_binary_view* v) {
+    assert(v != NULL && ason_binary_get_type(v) == ASON_NUMBER);
+    return *v->p == ASON_BIN_INTEGER;
+}
+
+static uint64_t ason_bin_get64(const unsigned char* p) {
+    return (uint64_t)ason_bin_get32(p) | (uint64_t)ason_bin_get32(p + 4) << 32;
+}
+
+double ason_binary_get_number(const ason_binary_view* v) {
+    uint64_t bits;
+    double d;
+    assert(v != NULL && ason_binary_get_type(v) == ASON_NUMBER);
+    bits = ason_bin_get64(v->p + 1);
+    if (*v->p == ASON_BIN_INTEGER)
+        return (double)(int64_t)bits;
+    memcpy(&d, &bits, 8);
+    return d;
+}
+
+int64_t ason_binary_get_integer(const ason_binary_view* v) {
+    assert(v != NULL && *v->p == ASON_BIN_INTEGER);
+    return (int64_t)ason_bin_get64(v->p + 1);
+}
+
+const char* ason_binary_get_string(const ason_binary_view* v, size_t* length) {
+    assert(v != NULL && *v->p == ASON_STRING && length != NULL);
+    *length = ason_bin_get32(v->p + 1);
+    return (const char*)v->p + 5;
+}
+
+size_t ason_binary_get_size(const ason_binary_view* v) {
+    assert(v != NULL && (*v->p == ASON_ARRAY || *v->p == ASON_OBJECT));
+    return ason_bin_get32(v->p + 1);
+}
+
+void ason_binary_get_element(const ason_binary_view* v, size_t index, ason_binary_view* out) {
+    assert(v != NULL && *v->p == ASON_ARRAY && out != NULL);
+    assert(index < ason_bin_get32(v->p + 1));
+    out->p = v->p + ason_bin_get32(v->p + 5 + index * 4);
+}
+
+/* the entry's key, whose value node follows its '\0' */
+static const unsigned char* ason_bin_entry(const unsigned char* obj, size_t index) {
+    return obj + ason_bin_get32(obj + 5 + index * 4);
+}
+
+const char* ason_binary_get_key(const ason_binary_view* v, size_t index, size_t* length) {
+    const unsigned char* e;
+    assert(v != NULL && *v->p == ASON_OBJECT && length != NULL);
+    assert(index < ason_bin_get32(v->p + 1));
+    e = ason_bin_entry(v->p, index);
+    *length = ason_bin_get32(e);
+    return (const char*)e + 4;
+}
+
+void ason_binary_get_value(const ason_binary_view* v, size_t index, ason_binary_view* out) {
+    const unsigned char* e;
+    assert(v != NULL && *v->p == ASON_OBJECT && out != NULL);
+    assert(index < ason_bin_get32(v->p + 1));
+    e = ason_bin_entry(v->p, index);
+    out->p = e + 4 + ason_bin_get32(e) + 1;
+}
+
+size_t ason_binary_find_key(const ason_binary_view* v, const char* key, size_t klen) {
+    const unsigned char *sorted, *e;
+    size_t lo = 0, hi, mid;
+    assert(v != NULL && *v->p == ASON_OBJECT && (key != NULL || klen == 0));
+    hi = ason_bin_get32(v->p + 1);
+    sorted = v->p + 5 + hi * 4;
+    /* lower bound, so duplicates resolve to the first */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        e = ason_bin_entry(v->p, ason_bin_get32(sorted + mid * 4));
+        if (ason_bin_compare((const char*)e + 4, ason_bin_get32(e), key, klen) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == ason_bin_get32(v->p + 1))
+        return ASON_KEY_NOT_EXIST;
+    mid = ason_bin_get32(sorted + lo * 4);
+    e = ason_bin_entry(v->p, mid);
+    return ason_bin_compare((const char*)e + 4, ason_bin_get32(e), key, klen) == 0 ? mid : ASON_KEY_NOT_EXIST;
+}
+
+static void ason_bin_decode(ason_context* c, const ason_binary_view* v, ason_value* out) {
+    ason_binary_view child;
+    ason_entry e;
+    ason_value m;
+    const char* s;
+    size_t i, n, len;
+    uint64_t bits;
+    switch (*v->p) {
+        case ASON_NUMBER:
+        case ASON_BIN_INTEGER:
+            bits = ason_bin_get64(v->p + 1);
+            memcpy(&out->u.num, &bits, 8);
+            out->type = ASON_NUMBER;
+            out->flags = *v->p == ASON_BIN_INTEGER ? ASON_F_INTEGER : 0;
+            break;
+        case ASON_STRING:
+            s = ason_binary_get_string(v, &len);
+            ason_value_set_string(out, s, len, NULL);
+            break;
+        case ASON_ARRAY:
+            n = ason_binary_get_size(v);
+            for (i = 0; i < n; i++) {
+                ason_init(&m);
+                ason_binary_get_element(v, i, &child);
+                ason_bin_decode(c, &child, &m);
+                memcpy(ason_context_push(c, sizeof(ason_value)), &m, sizeof(ason_value));
+            }
+            ason_context_pop_array(c, out, n);
+            break;
+        case ASON_OBJECT:
+            n = ason_binary_get_size(v);
+            for (i = 0; i < n; i++) {
+                s = ason_binary_get_key(v, i, &len);
+                ason_context_new_string(c, &e.k, s, len);
+                ason_init(&e.v);
+                ason_binary_get_value(v, i, &child);
+                ason_bin_decode(c, &child, &e.v);
+                memcpy(ason_context_push(c, sizeof(ason_entry)), &e, sizeof(ason_entry));
+            }
+            ason_context_pop_object(c, out, n);
+            break;
+        default:
+            out->type = *v->p;
+            break;
+    }
+}
+
+void ason_binary_to_value(const ason_binary_view* v, ason_value* out) {
+    ason_context c;
+    assert(v != NULL && v->p != NULL && out != NULL);
+    ason_context_init(&c, NULL, 0, 0);
+    ason_init(out);
+    ason_bin_decode(&c, v, out);
+    ASON_FREE(c.stack);
+}
+
+static void ason_object_free_key(const ason_value* v, char* s) {
+    if (v->flags & ASON_F_KEYS_BORROWED)
+        return;
+    if (v->flags & ASON_F_KEYS_INTERNED)
+        ason_key_release(s);
+    else
+        ASON_FREE(s);
+}
+
+/* frees what v owns itself, its members must be freed already */
+static void ason_free_node(ason_value* v) {
+    size_t i, size;
+    switch (v->type) {
+        case ASON_STRING:
+            if (!(v->flags & (ASON_F_BORROWED | ASON_F_INLINE)))
+                ASON_FREE(v->u.s);
+            break;
+        case ASON_NUMBER:
+            if ((v->flags & (ASON_F_RAW | ASON_F_BORROWED)) == ASON_F_RAW)
+                ASON_FREE(v->u.s);
+            break;
+        case ASON_ARRAY:
+            if (v->u.m != NULL && !(v->flags & ASON_F_BORROWED))
+                ASON_FREE(ASON_HEADER(v));
+            break;
+        case ASON_OBJECT:
+            size = ASON_SIZE(v);
+            for (i = 0; i < size; i++)
+                ason_object_free_key(v, v->u.e[i].k.s);
+            if (v->u.e != NULL && !(v->flags & ASON_F_BORROWED)) {
+                ASON_FREE(ASON_OBJECT_INDEX(v));
+                ASON_FREE(ASON_HEADER(v));
+            }
+            break;
+        default:
+            break;
+    }
+    v->type = ASON_NULL;
+    v->flags = 0;
+}
+
+typedef struct {
+    ason_value* v; /* container whose members are being freed */
+    size_t i, size;
+} ason_free_frame;
+
+/* depth first without recursion, the path of open containers is an explicit stack */
+void ason_free(ason_value* v) {
+    ason_free_frame local[ASON_FREE_STACK_SIZE], *stack = local, *f;
+    size_t depth = 0, cap = ASON_FREE_STACK_SIZE;
+    ason_value* m;
+    assert(v != NULL);
+    if ((v->type != ASON_ARRAY && v->type != ASON_OBJECT) || ASON_SIZE(v) == 0) {
+        ason_free_node(v);
+        return;
+    }
+    local[0].v = v;
+    local[0].i = 0;
+    local[0].size = ASON_SIZE(v);
+    for (depth = 1; depth > 0; ) {
+        f = &stack[depth - 1];
+        while (f->i < f->size) {
+            if (f->v->type == ASON_ARRAY)
+                m = &f->v->u.m[f->i];
+            else {
+                /* keys go along with their values, in allocation order */
+                m = &f->v->u.e[f->i].v;
+                ason_object_free_key(f->v, f->v->u.e[f->i].k.s);
+            }
+            f->i++;
+            if (m->type == ASON_STRING) {
+                if (!(m->flags & (ASON_F_BORROWED | ASON_F_INLINE)))
+                    ASON_FREE(m->u.s);
+            }
+            else if ((m->type == ASON_ARRAY || m->type == ASON_OBJECT) && ASON_SIZE(m) > 0) {
+                if (depth == cap) {
+                    cap *= 2;
+                    if (stack == local) {
+                        stack = (ason_free_frame*)ASON_MALLOC(cap * sizeof(ason_free_frame));
+                        memcpy(stack, local, sizeof(local));
+                    }
+                    else
+                        stack = (ason_free_frame*)ASON_REALLOC(stack, cap * sizeof(ason_free_frame));
+                }
+                f = &stack[depth++];
+                f->v = m;
+                f->i = 0;
+                f->size = ASON_SIZE(m);
+            }
+            else
+                ason_free_node(m);
+        }
+        ASON_SET_SIZE(f->v, 0); /* the keys are gone */
+        ason_free_node(f->v);
+        depth--;
+    }
+    if (stack != local)
+        ASON_FREE(stack);
+}
+
+ason_type ason_get_type(const ason_value* v) {
+    assert(v != NULL);
+    return v->type;
+}
+
+int ason_get_boolean(const ason_value* v) {
+    assert(v != NULL && (v->type == ASON_TRUE || v->type == ASON_FALSE));
+    return v->type == ASON_TRUE ? 1 : 0;
+}
+
+void ason_set_boolean(ason_value* v, int b) {
+    assert(v != NULL);
+    ason_free(v);
+    v->type = b ? ASON_TRUE : ASON_FALSE;
+}
+
+double ason_get_number(const ason_value* v) {
+    ason_value tmp;
+    assert(v != NULL && v->type == ASON_NUMBER);
+    v = ason_number_value(v, &tmp);
+    return v->flags & ASON_F_INTEGER ? (double)v->u.num.i : v->u.num.d;
+}
+
+void ason_set_number(ason_value* v, double n) {
+    assert(v != NULL);
+    ason_free(v);
+    v->u.num.d = n;
+    v->type = ASON_NUMBER;
+}
+
+int ason_is_integer(const ason_value* v) {
+    ason_value tmp;
+    assert(v != NULL && v->type == ASON_NUMBER);
+    return (ason_number_value(v, &tmp)->flags & ASON_F_INTEGER) != 0;
+}
+
+int64_t ason_get_integer(const ason_value* v) {
+    ason_value tmp;
+    assert(v != NULL && v->type == ASON_NUMBER);
+    v = ason_number_value(v, &tmp);
+    assert(v->flags & ASON_F_INTEGER);
+    return v->u.num.i;
+}
+
+const char* ason_get_number_text(const ason_value* v, size_t* length) {
+    assert(v != NULL && v->type == ASON_NUMBER);
+    if (!(v->flags & ASON_F_RAW))
+        return NULL;
+    if (length)
+        *length = ASON_SIZE(v);
+    return v->u.s;
+}
+
+void ason_set_integer(ason_value* v, int64_t i) {
+    assert(v != NULL);
+    ason_free(v);
+    v->u.num.i = i;
+    v->flags = ASON_F_INTEGER;
+    v->type = ASON_NUMBER;
+}
+
+const char* ason_get_string(const ason_value* v) {
+    assert(v != NULL && v->type == ASON_STRING);
+    return ASON_STR(v);
+}
+
+size_t ason_get_string_length(const ason_value* v) {
+    assert(v != NULL && v->type == ASON_STRING);
+    return ASON_STR_LEN(v);
+}
+
+void ason_new_string(ason_string* str, const char* s, size_t len) {
+    assert(str != NULL && (s != NULL || len == 0));
+    str->s = (char*)ASON_MALLOC(len+1);
+    memcpy(str->s, s, len);
+    str->s[len] = '\0';
+    str->len = len;
 }
 
 void ason_set_string(ason_value* v, const char* s, size_t len) {
     assert(v != NULL && (s != NULL || len == 0));
     ason_free(v);
-    ason_new_string(&v->u.str, s, len);
-    v->type = ASON_STRING;
+    ason_value_set_string(v, s, len, NULL);
 }
 
 size_t ason_get_array_size(const ason_value* v) {
     assert(v != NULL && v->type == ASON_ARRAY);
-    return v->u.arr.size;
+    return ASON_SIZE(v);
 }
 
 ason_value* ason_get_array_element(const ason_value* v, size_t index) {
     assert(v != NULL && v->type == ASON_ARRAY);
-    assert(index >=0 && index < v->u.arr.size);
-    return v->u.arr.m + index;
+    assert(index >=0 && index < ASON_SIZE(v));
+    return v->u.m + index;
 }
 
 size_t ason_get_object_entry_size(const ason_value* v) {
     assert(v != NULL && v->type == ASON_OBJECT);
-    return v->u.obj.size;
+    return ASON_SIZE(v);
 }
 
 const char* ason_get_object_key(const ason_value* v, size_t index) {
     assert(v != NULL && v->type == ASON_OBJECT);
-    assert(index >=0 && index < v->u.obj.size);
-    return v->u.obj.e[index].k.s;
+    assert(index >=0 && index < ASON_SIZE(v));
+    return v->u.e[index].k.s;
 }
 
 size_t ason_get_object_key_length(const ason_value* v, size_t index) {
     assert(v != NULL && v->type == ASON_OBJECT);
-    assert(index >=0 && index < v->u.obj.size);
-    return v->u.obj.e[index].k.len;
+    assert(index >=0 && index < ASON_SIZE(v));
+    return v->u.e[index].k.len;
 }
 
 ason_value* ason_get_object_value(const ason_value* v, size_t index) {
     assert(v != NULL && v->type == ASON_OBJECT);
-    assert(index >=0 && index < v->u.obj.size);
-    return &v->u.obj.e[index].v;
+    assert(index >=0 && index < ASON_SIZE(v));
+    return &v->u.e[index].v;
+}
+
+/* hash is only looked at for objects of ASON_OBJECT_INDEX_MIN_SIZE entries or more */
+static size_t ason_object_find(const ason_value* v, const char* key, size_t klen, uint32_t hash) {
+    const ason_entry* e = v->u.e;
+    size_t i, mask, size = ASON_SIZE(v);
+    uint32_t* index;
+    if (size == 0)
+        return ASON_KEY_NOT_EXIST;
+    if ((index = ASON_OBJECT_INDEX(v)) == NULL) {
+        if (size < ASON_OBJECT_INDEX_MIN_SIZE || (v->flags & ASON_F_BORROWED)) {
+            for (i = 0; i < size; i++)
+                if (e[i].k.s == key || (e[i].k.len == klen && memcmp(e[i].k.s, key, klen) == 0))
+                    return i;
+            return ASON_KEY_NOT_EXIST;
+        }
+        /* the cache is not part of the value's observable state */
+        index = ASON_OBJECT_INDEX(v) = (uint32_t*)ASON_MALLOC(ason_object_index_capacity(size) * sizeof(uint32_t));
+        ason_object_index_build(v, index);
+    }
+    mask = ason_object_index_capacity(size) - 1;
+    for (i = hash & mask; index[i] != 0; i = (i + 1) & mask) {
+        const ason_string* k = &e[index[i] - 1].k;
+        if (k->s == key || (k->len == klen && memcmp(k->s, key, klen) == 0))
+            return index[i] - 1;
+    }
+    return ASON_KEY_NOT_EXIST;
+}
+
+size_t ason_find_object_index(const ason_value* v, const char* key, size_t klen) {
+    assert(v != NULL && v->type == ASON_OBJECT && (key != NULL || klen == 0));
+    return ason_object_find(v, key, klen, ASON_SIZE(v) >= ASON_OBJECT_INDEX_MIN_SIZE ? ason_hash_key(key, klen) : 0);
+}
+
+ason_value* ason_find_object_value(const ason_value* v, const char* key, size_t klen) {
+    size_t index = ason_find_object_index(v, key, klen);
+    return index != ASON_KEY_NOT_EXIST ? &v->u.e[index].v : NULL;
+}
+
+/* containers from a document live in its arena and cannot be resized */
+static void ason_container_resize(ason_value* v, size_t elem, size_t capacity) {
+    ason_header* h = ASON_ELEMENTS(v) != NULL ? ASON_HEADER(v) : NULL;
+    assert(!(v->flags & ASON_F_BORROWED) && capacity >= ASON_SIZE(v));
+    if (capacity == 0) {
+        if (h != NULL)
+            ASON_FREE(h->index);
+        ASON_FREE(h);
+        h = NULL;
+    }
+    else {
+        if (h == NULL) {
+            h = (ason_header*)ASON_MALLOC(ASON_HEADER_SIZE + capacity * elem);
+            h->index = NULL;
+        }
+        else
+            h = (ason_header*)ASON_REALLOC(h, ASON_HEADER_SIZE + capacity * elem);
+        h->capacity = capacity;
+    }
+    if (v->type == ASON_ARRAY)
+        v->u.m = h ? (ason_value*)((char*)h + ASON_HEADER_SIZE) : NULL;
+    else
+        v->u.e = h ? (ason_entry*)((char*)h + ASON_HEADER_SIZE) : NULL;
+}
+
+static size_t ason_container_capacity(const ason_value* v) {
+    return ASON_ELEMENTS(v) != NULL ? ASON_HEADER(v)->capacity : 0;
+}
+
+/* room for one more, doubling the capacity */
+static void ason_container_grow(ason_value* v, size_t elem) {
+    size_t capacity = ason_container_capacity(v);
+    if (ASON_SIZE(v) == capacity)
+        ason_container_resize(v, elem, capacity == 0 ? 1 : capacity * 2);
+}
+
+void ason_set_array(ason_value* v, size_t capacity) {
+    assert(v != NULL);
+    ason_free(v);
+    v->type = ASON_ARRAY;
+    v->flags = 0;
+    v->u.m = NULL;
+    ASON_SET_SIZE(v, 0);
+    if (capacity > 0)
+        ason_container_resize(v, sizeof(ason_value), capacity);
+}
+
+size_t ason_get_array_capacity(const ason_value* v) {
+    assert(v != NULL && v->type == ASON_ARRAY);
+    return ason_container_capacity(v);
+}
+
+void ason_reserve_array(ason_value* v, size_t capacity) {
+    assert(v != NULL && v->type == ASON_ARRAY);
+    if (ason_container_capacity(v) < capacity)
+        ason_container_resize(v, sizeof(ason_value), capacity);
+}
+
+void ason_shrink_array(ason_value* v) {
+    assert(v != NULL && v->type == ASON_ARRAY);
+    if (ason_container_capacity(v) > ASON_SIZE(v))
+        ason_container_resize(v, sizeof(ason_value), ASON_SIZE(v));
+}
+
+void ason_clear_array(ason_value* v) {
+    assert(v != NULL && v->type == ASON_ARRAY);
+    ason_erase_array_element(v, 0, ASON_SIZE(v));
+}
+
+ason_value* ason_pushback_array_element(ason_value* v) {
+    return ason_insert_array_element(v, ason_get_array_size(v));
+}
+
+void ason_popback_array_element(ason_value* v) {
+    assert(v != NULL && v->type == ASON_ARRAY && ASON_SIZE(v) > 0);
+    ason_erase_array_element(v, ASON_SIZE(v) - 1, 1);
+}
+
+ason_value* ason_insert_array_element(ason_value* v, size_t index) {
+    size_t size;
+    assert(v != NULL && v->type == ASON_ARRAY && index <= ASON_SIZE(v));
+    ason_container_grow(v, sizeof(ason_value));
+    size = ASON_SIZE(v);
+    memmove(v->u.m + index + 1, v->u.m + index, (size - index) * sizeof(ason_value));
+    ASON_SET_SIZE(v, size + 1);
+    ason_init(&v->u.m[index]);
+    return &v->u.m[index];
+}
+
+void ason_erase_array_element(ason_value* v, size_t index, size_t count) {
+    size_t i, size;
+    assert(v != NULL && v->type == ASON_ARRAY && index + count <= ASON_SIZE(v));
+    if (count == 0)
+        return;
+    assert(!(v->flags & ASON_F_BORROWED));
+    size = ASON_SIZE(v);
+    for (i = index; i < index + count; i++)
+        ason_free(&v->u.m[i]);
+    memmove(v->u.m + index, v->u.m + index + count, (size - index - count) * sizeof(ason_value));
+    ASON_SET_SIZE(v, size - count);
+}
+
+void ason_set_object(ason_value* v, size_t capacity) {
+    assert(v != NULL);
+    ason_free(v);
+    v->type = ASON_OBJECT;
+    v->flags = 0;
+    v->u.e = NULL;
+    ASON_SET_SIZE(v, 0);
+    if (capacity > 0)
+        ason_container_resize(v, sizeof(ason_entry), capacity);
+}
+
+size_t ason_get_object_capacity(const ason_value* v) {
+    assert(v != NULL && v->type == ASON_OBJECT);
+    return ason_container_capacity(v);
+}
+
+void ason_reserve_object(ason_value* v, size_t capacity) {
+    assert(v != NULL && v->type == ASON_OBJECT);
+    if (ason_container_capacity(v) < capacity)
+        ason_container_resize(v, sizeof(ason_entry), capacity);
+}
+
+void ason_shrink_object(ason_value* v) {
+    assert(v != NULL && v->type == ASON_OBJECT);
+    if (ason_container_capacity(v) > ASON_SIZE(v))
+        ason_container_resize(v, sizeof(ason_entry), ASON_SIZE(v));
+}
+
+void ason_clear_object(ason_value* v) {
+    assert(v != NULL && v->type == ASON_OBJECT);
+    while (ASON_SIZE(v) > 0)
+        ason_remove_object_value(v, ASON_SIZE(v) - 1);
+}
+
+/* keys of different origins cannot share one set of flags, so added keys make all of them owned */
+static void ason_object_own_keys(ason_value* v) {
+    ason_string k;
+    size_t i;
+    if (!(v->flags & (ASON_F_KEYS_BORROWED | ASON_F_KEYS_INTERNED)))
+        return;
+    for (i = 0; i < ASON_SIZE(v); i++) {
+        k = v->u.e[i].k;
+        ason_new_string(&v->u.e[i].k, k.s, k.len);
+        ason_object_free_key(v, k.s);
+    }
+    v->flags &= ~(ASON_F_KEYS_BORROWED | ASON_F_KEYS_INTERNED);
+}
+
+/* keeps a built index in step with an appended entry, it is rebuilt on lookup when the table has to grow */
+static void ason_object_index_append(ason_value* v) {
+    uint32_t* index = ASON_OBJECT_INDEX(v);
+    size_t i, size = ASON_SIZE(v), mask = ason_object_index_capacity(size) - 1;
+    if (index == NULL)
+        return;
+    if (mask + 1 != ason_object_index_capacity(size - 1)) {
+        ASON_FREE(index);
+        ASON_OBJECT_INDEX(v) = NULL;
+        return;
+    }
+    for (i = ason_hash_key(v->u.e[size - 1].k.s, v->u.e[size - 1].k.len) & mask; index[i] != 0; i = (i + 1) & mask)
+        ;
+    index[i] = (uint32_t)size;
+}
+
+ason_value* ason_set_object_value(ason_value* v, const char* key, size_t klen) {
+    size_t index = ason_find_object_index(v, key, klen);
+    ason_entry* e;
+    if (index != ASON_KEY_NOT_EXIST)
+        return &v->u.e[index].v;
+    ason_container_grow(v, sizeof(ason_entry));
+    ason_object_own_keys(v);
+    e = &v->u.e[ASON_SIZE(v)];
+    ason_new_string(&e->k, key, klen);
+    ason_init(&e->v);
+    ASON_SET_SIZE(v, ASON_SIZE(v) + 1);
+    ason_object_index_append(v);
+    return &e->v;
+}
+
+void ason_remove_object_value(ason_value* v, size_t index) {
+    size_t size;
+    assert(v != NULL && v->type == ASON_OBJECT && index < ASON_SIZE(v) && !(v->flags & ASON_F_BORROWED));
+    size = ASON_SIZE(v);
+    ason_free(&v->u.e[index].v);
+    ason_object_free_key(v, v->u.e[index].k.s);
+    memmove(v->u.e + index, v->u.e + index + 1, (size - index - 1) * sizeof(ason_entry));
+    ASON_SET_SIZE(v, size - 1);
+    /* entry indices moved */
+    ASON_FREE(ASON_OBJECT_INDEX(v));
+    ASON_OBJECT_INDEX(v) = NULL;
+}
+
+void ason_move(ason_value* dst, ason_value* src) {
+    assert(dst != NULL && src != NULL && src != dst);
+    ason_free(dst);
+    memcpy(dst, src, sizeof(ason_value));
+    ason_init(src);
+}
+
+void ason_swap(ason_value* lhs, ason_value* rhs) {
+    ason_value temp;
+    assert(lhs != NULL && rhs != NULL);
+    if (lhs != rhs) {
+        memcpy(&temp, lhs, sizeof(ason_value));
+        memcpy(lhs,   rhs, sizeof(ason_value));
+        memcpy(rhs, &temp, sizeof(ason_value));
+    }
+}
+
+/* dst is overwritten; every container is allocated once, at its final size */
+static void ason_copy_value(ason_value* dst, const ason_value* src) {
+    size_t i, size = ASON_SIZE(src);
+    int shared;
+    switch (src->type) {
+        case ASON_STRING:
+            if (src->flags & ASON_F_INLINE)
+                memcpy(dst, src, sizeof(ason_value));
+            else
+                ason_value_set_string(dst, src->u.s, size, NULL);
+            break;
+        case ASON_ARRAY:
+            ason_init(dst);
+            ason_set_array(dst, size);
+            for (i = 0; i < size; i++)
+                ason_copy_value(&dst->u.m[i], &src->u.m[i]);
+            ASON_SET_SIZE(dst, size);
+            break;
+        case ASON_OBJECT:
+            ason_init(dst);
+            ason_set_object(dst, size);
+            /* interned heap keys are shared, not copied */
+            shared = (src->flags & (ASON_F_KEYS_INTERNED | ASON_F_KEYS_BORROWED)) == ASON_F_KEYS_INTERNED;
+            for (i = 0; i < size; i++) {
+                if (shared) {
+                    dst->u.e[i].k = src->u.e[i].k;
+                    ason_key_retain(dst->u.e[i].k.s);
+                }
+                else
+                    ason_new_string(&dst->u.e[i].k, src->u.e[i].k.s, src->u.e[i].k.len);
+                ason_copy_value(&dst->u.e[i].v, &src->u.e[i].v);
+            }
+            if (shared)
+                dst->flags |= ASON_F_KEYS_INTERNED;
+            ASON_SET_SIZE(dst, size);
+            break;
+        case ASON_NUMBER:
+            memcpy(dst, src, sizeof(ason_value));
+            /* raw text is copied, the input it came from may go away */
+            if (src->flags & ASON_F_RAW) {
+                dst->u.s = (char*)ASON_MALLOC(size);
+                memcpy(dst->u.s, src->u.s, size);
+                dst->flags = ASON_F_RAW;
+            }
+            break;
+        default:
+            memcpy(dst, src, sizeof(ason_value));
+            break;
+    }
+}
+
+void ason_copy(ason_value* dst, const ason_value* src) {
+    assert(dst != NULL && src != NULL && src != dst);
+    ason_free(dst);
+    ason_copy_value(dst, src);
+}
+
+/* exactly, as converting i to double rounds above 2^53 */
+static int ason_int_is_double(int64_t i, double d) {
+    return d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (int64_t)d == i && (double)i == d;
+}
+
+/* next[i] is the following entry with the key of entry i; last is scratch indexed by first occurrence */
+static void ason_object_link(const ason_value* v, size_t* next, size_t* last) {
+    size_t i, first, size = ASON_SIZE(v);
+    for (i = 0; i < size; i++) {
+        next[i] = ASON_KEY_NOT_EXIST;
+        first = ason_find_object_index(v, v->u.e[i].k.s, v->u.e[i].k.len);
+        if (first != i)
+            next[last[first]] = i;
+        last[first] = i;
+    }
+}
+
+/* equal keys are matched through the hash index of large objects, duplicates in order of occurrence */
+int ason_is_equal(const ason_value* lhs, const ason_value* rhs) {
+    ason_value ltmp, rtmp;
+    const ason_string* k;
+    size_t i, first, index, size, *pair, *next;
+    int equal;
+    assert(lhs != NULL && rhs != NULL);
+    if (lhs->type != rhs->type)
+        return 0;
+    switch (lhs->type) {
+        case ASON_NUMBER:
+            lhs = ason_number_value(lhs, &ltmp);
+            rhs = ason_number_value(rhs, &rtmp);
+            if (lhs->flags & rhs->flags & ASON_F_INTEGER)
+                return lhs->u.num.i == rhs->u.num.i;
+            if (lhs->flags & ASON_F_INTEGER)
+                return ason_int_is_double(lhs->u.num.i, rhs->u.num.d);
+            if (rhs->flags & ASON_F_INTEGER)
+                return ason_int_is_double(rhs->u.num.i, lhs->u.num.d);
+            return lhs->u.num.d == rhs->u.num.d;
+        case ASON_STRING:
+            return ASON_STR_LEN(lhs) == ASON_STR_LEN(rhs) && memcmp(ASON_STR(lhs), ASON_STR(rhs), ASON_STR_LEN(lhs)) == 0;
+        case ASON_ARRAY:
+            if ((size = ASON_SIZE(lhs)) != ASON_SIZE(rhs))
+                return 0;
+            for (i = 0; i < size; i++)
+                if (!ason_is_equal(&lhs->u.m[i], &rhs->u.m[i]))
+                    return 0;
+            return 1;
+        case ASON_OBJECT:
+            if ((size = ASON_SIZE(lhs)) != ASON_SIZE(rhs))
+                return 0;
+            for (i = 0, pair = next = NULL, equal = 1; i < size && equal; i++) {
+                k = &lhs->u.e[i].k;
+                if ((first = ason_find_object_index(lhs, k->s, k->len)) == i)
+                    index = ason_find_object_index(rhs, k->s, k->len);
+                else {
+                    /* the n-th occurrence of a duplicate key pairs with the n-th one in rhs,
+                     * pair[first] being the rhs entry of the previous one */
+                    if (pair == NULL) {
+                        pair = (size_t*)ASON_MALLOC(size * 2 * sizeof(size_t));
+                        next = pair + size;
+                        ason_object_link(rhs, next, pair);
+                        for (index = 0; index < size; index++)
+                            pair[index] = ASON_KEY_NOT_EXIST;
+                    }
+                    if (pair[first] == ASON_KEY_NOT_EXIST)
+                        pair[first] = ason_find_object_index(rhs, k->s, k->len);
+                    index = pair[first] = next[pair[first]];
+                }
+                equal = index != ASON_KEY_NOT_EXIST && ason_is_equal(&lhs->u.e[i].v, &rhs->u.e[index].v);
+            }
+            ASON_FREE(pair);
+            return equal;
+        default:
+            return 1;
+    }
+}
+
+static uint64_t ason_hash_mix(uint64_t x) {
+    /* splitmix64 finalizer */
+    x ^= x >> 30;
+    x *= ASON_UINT64_C2(0xBF58476D, 0x1CE4E5B9);
+    x ^= x >> 27;
+    x *= ASON_UINT64_C2(0x94D049BB, 0x133111EB);
+    return x ^ (x >> 31);
+}
+
+static uint64_t ason_hash_bytes(uint64_t h, const char* s, size_t len) {
+    h ^= ASON_UINT64_C2(0xCBF29CE4, 0x84222325); /* FNV-1a */
+    while (len--)
+        h = (h ^ (unsigned char)*s++) * ASON_UINT64_C2(0x00000100, 0x000001B3);
+    return ason_hash_mix(h);
+}
+
+/* numbers hash as doubles and objects as a sum over entries, so values that compare equal hash equal */
+uint64_t ason_hash(const ason_value* v) {
+    uint64_t h, sum;
+    size_t i, size;
+    double d;
+    assert(v != NULL);
+    h = ason_hash_mix((uint64_t)v->type + 1);
+    switch (v->type) {
+        case ASON_NUMBER:
+            d = ason_get_number(v);
+            if (d == 0.0)
+                d = 0.0; /* -0.0 */
+            memcpy(&sum, &d, sizeof(d));
+            return ason_hash_mix(h ^ sum);
+        case ASON_STRING:
+            return ason_hash_bytes(h, ASON_STR(v), ASON_STR_LEN(v));
+        case ASON_ARRAY:
+            size = ASON_SIZE(v);
+            for (i = 0; i < size; i++)
+                h = ason_hash_mix(h * 31 + ason_hash(&v->u.m[i]));
+            return ason_hash_mix(h ^ size);
+        case ASON_OBJECT:
+            size = ASON_SIZE(v);
+            for (i = 0, sum = 0; i < size; i++)
+                sum += ason_hash_mix(ason_hash_bytes(0, v->u.e[i].k.s, v->u.e[i].k.len) ^ ason_hash(&v->u.e[i].v));
+            return ason_hash_mix(h ^ sum ^ size);
+        default:
+            return h;
+    }
+}
+
+typedef struct {
+    const char* key; /* unescaped, in ason_path.keys */
+    size_t len;
+    uint32_t hash;
+    size_t index; /* ASON_KEY_NOT_EXIST unless the token is a valid array index */
+} ason_path_token;
+
+struct ason_path {
+    ason_path_token* tokens;
+    size_t count;
+    char* keys;
+};
+
+ason_path* ason_path_compile(const char* pointer) {
+    ason_path* path;
+    ason_path_token* t;
+    const char* p;
+    char* k;
+    size_t n;
+    assert(pointer != NULL);
+    if (*pointer != '\0' && *pointer != '/')
+        return NULL;
+    for (p = pointer, n = 0; *p; p++)
+        n += *p == '/';
+    path = (ason_path*)ASON_MALLOC(sizeof(ason_path));
+    path->tokens = (ason_path_token*)ASON_MALLOC((n > 0 ? n : 1) * sizeof(ason_path_token));
+    path->count = n;
+    path->keys = k = (char*)ASON_MALLOC(strlen(pointer) + 1);
+    for (p = pointer, t = path->tokens; *p; t++) {
+        t->key = k;
+        for (p++; *p && *p != '/'; p++) {
+            if (*p != '~')
+                *k++ = *p;
+            else if (p[1] == '0' || p[1] == '1')
+                *k++ = *++p == '0' ? '~' : '/';
+            else {
+                ason_path_free(path);
+                return NULL;
+            }
+        }
+        t->len = (size_t)(k - t->key);
+        t->hash = ason_hash_key(t->key, t->len);
+        /* digits without a leading zero, "-" and the like never match an element */
+        t->index = t->len > 0 && (t->len == 1 || t->key[0] != '0') ? 0 : ASON_KEY_NOT_EXIST;
+        for (n = 0; n < t->len && t->index != ASON_KEY_NOT_EXIST; n++) {
+            if (t->key[n] < '0' || t->key[n] > '9' || t->index > (ASON_KEY_NOT_EXIST - 9) / 10)
+                t->index = ASON_KEY_NOT_EXIST;
+            else
+                t->index = t->index * 10 + (size_t)(t->key[n] - '0');
+        }
+    }
+    return path;
+}
+
+void ason_path_free(ason_path* path) {
+    if (path == NULL)
+        return;
+    ASON_FREE(path->tokens);
+    ASON_FREE(path->keys);
+    ASON_FREE(path);
+}
+
+ason_value* ason_path_eval(const ason_path* path, const ason_value* v) {
+    size_t i, index;
+    assert(path != NULL && v != NULL);
+    for (i = 0; i < path->count; i++) {
+        const ason_path_token* t = &path->tokens[i];
+        if (v->type == ASON_OBJECT) {
+            if ((index = ason_object_find(v, t->key, t->len, t->hash)) == ASON_KEY_NOT_EXIST)
+                return NULL;
+            v = &v->u.e[index].v;
+        }
+        else if (v->type == ASON_ARRAY && t->index < ASON_SIZE(v))
+            v = &v->u.m[t->index];
+        else
+            return NULL;
+    }
+    return (ason_value*)v;
+}
+
+/* moves past one value without decoding it, only strings and bracket nesting are checked */
+static int ason_skip_value(ason_context* c) {
+    const char* p;
+    size_t depth = 0;
+    do {
+        switch (PEEK(c)) {
+            case '"':
+                for (p = c->json + 1; ; p += *p == '\\' && p + 1 != c->end ? 2 : 1)
+                    if ((p = ason_scan_string(p, c->end)) == c->end)
+                        return ASON_PARSE_MISS_QUOTATION_MARK;
+                    else if (*p == '"')
+                        break;
+                c->json = p + 1;
+                break;
+            case '[': case '{':
+                depth++;
+                c->json++;
+                break;
+            case ']': case '}':
+                if (depth-- == 0)
+                    return ASON_PARSE_INVALID_VALUE;
+                c->json++;
+                break;
+            case ',': case ':':
+                if (depth == 0)
+                    return ASON_PARSE_INVALID_VALUE;
+                c->json++;
+                break;
+            case '\0':
+                if (c->json == c->end)
+                    return depth == 0 ? ASON_PARSE_EXPECT_VALUE : ASON_PARSE_INVALID_VALUE;
+                c->json++;
+                break;
+            default:
+                if (ISWHITESPACE(*c->json))
+                    ason_parse_whitespace(c);
+                else
+                    do {
+                        c->json++;
+                    } while (c->json != c->end && !ISWHITESPACE(*c->json) && *c->json != ',' &&
+                        *c->json != ']' && *c->json != '}' && *c->json != ':');
+                break;
+        }
+    } while (depth > 0);
+    return ASON_PARSE_OK;
+}
+
+/* steps into the member or element named by t, or fails without touching the rest */
+static int ason_path_step_text(ason_context* c, const ason_path_token* t) {
+    const char* key;
+    size_t i, klen;
+    int ret, match;
+    switch (PEEK(c)) {
+        case '{':
+            c->json++;
+            ason_parse_whitespace(c);
+            if (PEEK(c) == '}')
+                return ASON_PARSE_NOT_FOUND;
+            while (1) {
+                if (PEEK(c) != '"' || ason_parse_string_raw(c, &key, &klen) != ASON_PARSE_OK)
+                    return ASON_PARSE_MISS_KEY;
+                match = klen == t->len && memcmp(key, t->key, klen) == 0;
+                c->top = 0;
+                ason_parse_whitespace(c);
+                if (PEEK(c) != ':')
+                    return ASON_PARSE_MISS_COLON;
+                c->json++;
+                ason_parse_whitespace(c);
+                if (match)
+                    return ASON_PARSE_OK;
+                if ((ret = ason_skip_value(c)) != ASON_PARSE_OK)
+                    return ret;
+                ason_parse_whitespace(c);
+                if (PEEK(c) == '}')
+                    return ASON_PARSE_NOT_FOUND;
+                if (PEEK(c) != ',')
+                    return ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                c->json++;
+                ason_parse_whitespace(c);
+            }
+        case '[':
+            c->json++;
+            ason_parse_whitespace(c);
+            if (t->index == ASON_KEY_NOT_EXIST || PEEK(c) == ']')
+                return ASON_PARSE_NOT_FOUND;
+            for (i = 0; i < t->index; i++) {
+                if ((ret = ason_skip_value(c)) != ASON_PARSE_OK)
+                    return ret;
+                ason_parse_whitespace(c);
+                if (PEEK(c) == ']')
+                    return ASON_PARSE_NOT_FOUND;
+                if (PEEK(c) != ',')
+                    return ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                c->json++;
+                ason_parse_whitespace(c);
+            }
+            return ASON_PARSE_OK;
+        case '\0':
+            return c->json == c->end ? ASON_PARSE_EXPECT_VALUE : ASON_PARSE_INVALID_VALUE;
+        default:
+            return ASON_PARSE_NOT_FOUND;
+    }
+}
+
+int ason_path_eval_text(const ason_path* path, const char* json, size_t len, ason_value* v) {
+    ason_context c;
+    size_t i;
+    int ret = ASON_PARSE_OK;
+    assert(path != NULL && v != NULL && (json != NULL || len == 0));
+    ason_init(v);
+    ason_context_init(&c, json, len, 0);
+    ason_parse_whitespace(&c);
+    for (i = 0; i < path->count && ret == ASON_PARSE_OK; i++)
+        ret = ason_path_step_text(&c, &path->tokens[i]);
+    if (ret == ASON_PARSE_OK)
+        ret = ason_parse_value(&c, v);
+    assert(c.top == 0);
+    ASON_FREE(c.stack);
+    return ret;
+}
+
+/*
+ * Struct decoding. The field lists are compiled into one open-addressing table per
+ * object, keyed by the hash of the field name, so a member costs one hash and
+ * usually one compare. Members without a field are checked and skipped with the
+ * SAX grammar, nothing is built for them.
+ */
+typedef struct ason_schema_field ason_schema_field;
+
+typedef struct {
+    ason_schema_field* slots;
+    size_t mask;
+} ason_schema_object;
+
+struct ason_schema_field {
+    const ason_field* field; /* NULL for an empty slot */
+    size_t klen;
+    uint32_t hash;
+    ason_schema_object* object; /* ASON_FIELD_OBJECT */
+    ason_schema_field* elem;    /* ASON_FIELD_ARRAY */
+};
+
+struct ason_schema {
+    ason_arena arena;
+    ason_schema_object* root;
+};
+
+static ason_schema_object* ason_schema_compile_object(ason_arena* a, const ason_field* fields);
+
+static void ason_schema_compile_field(ason_arena* a, const ason_field* f, ason_schema_field* node) {
+    node->field = f;
+    node->klen = f->key ? strlen(f->key) : 0;
+    node->hash = ason_hash_key(f->key, node->klen);
+    node->object = NULL;
+    node->elem = NULL;
+    switch (f->type) {
+        case ASON_FIELD_STRING:
+            assert(f->size > 0);
+            break;
+        case ASON_FIELD_OBJECT:
+            assert(f->fields != NULL);
+            node->object = ason_schema_compile_object(a, f->fields);
+            break;
+        case ASON_FIELD_ARRAY:
+            assert(f->fields != NULL && f->stride > 0);
+            node->elem = (ason_schema_field*)ason_arena_alloc(a, sizeof(ason_schema_field));
+            ason_schema_compile_field(a, f->fields, node->elem);
+            break;
+        default:
+            break;
+    }
+}
+
+static ason_schema_object* ason_schema_compile_object(ason_arena* a, const ason_field* fields) {
+    ason_schema_object* o = (ason_schema_object*)ason_arena_alloc(a, sizeof(ason_schema_object));
+    size_t i, j, n, cap;
+    uint32_t hash;
+    for (n = 0; fields[n].key != NULL; n++)
+        ;
+    cap = ason_object_index_capacity(n);
+    o->mask = cap - 1;
+    o->slots = (ason_schema_field*)ason_arena_alloc(a, cap * sizeof(ason_schema_field));
+    memset(o->slots, 0, cap * sizeof(ason_schema_field));
+    for (i = 0; i < n; i++) {
+        hash = ason_hash_key(fields[i].key, strlen(fields[i].key));
+        for (j = hash & o->mask; o->slots[j].field != NULL; j = (j + 1) & o->mask)
+            ;
+        ason_schema_compile_field(a, &fields[i], &o->slots[j]);
+    }
+    return o;
+}
+
+ason_schema* ason_schema_compile(const ason_field* fields) {
+    ason_schema* schema;
+    assert(fields != NULL);
+    schema = (ason_schema*)ASON_MALLOC(sizeof(ason_schema));
+    ason_arena_init(&schema->arena, &ason_global_allocator);
+    schema->root = ason_schema_compile_object(&schema->arena, fields);
+    return schema;
+}
+
+void ason_schema_free(ason_schema* schema) {
+    if (schema == NULL)
+        return;
+    ason_arena_release(&schema->arena);
+    ASON_FREE(schema);
+}
+
+static const ason_sax_handler ason_skip_handler = { NULL };
+
+static int ason_decode_object(ason_context* c, const ason_schema_object* o, char* out);
+
+static int ason_decode_field(ason_context* c, const ason_schema_field* node, char* p) {
+    const ason_field* f = node->field;
+    const char* s;
+    size_t i, len, head = c->top;
+    ason_value v;
+    double d;
+    int ret;
+    ason_init(&v);
+    if (PEEK(c) == 'n')
+        return ason_parse_literal(c, &v, "null", 4, ASON_NULL);
+    switch (f->type) {
+        case ASON_FIELD_BOOL:
+            if (PEEK(c) == 't')
+                ret = ason_parse_literal(c, &v, "true", 4, ASON_TRUE);
+            else if (PEEK(c) == 'f')
+                ret = ason_parse_literal(c, &v, "false", 5, ASON_FALSE);
+            else
+                return ASON_PARSE_INCORRECT_TYPE;
+            if (ret == ASON_PARSE_OK)
+                *(int*)p = v.type == ASON_TRUE;
+            return ret;
+        case ASON_FIELD_INT:
+        case ASON_FIELD_INT64:
+        case ASON_FIELD_DOUBLE:
+            if (PEEK(c) != '-' && !ISDIGIT(PEEK(c)))
+                return ASON_PARSE_INCORRECT_TYPE;
+            if ((ret = ason_parse_number(c, &v)) != ASON_PARSE_OK)
+                return ret;
+            if (f->type == ASON_FIELD_DOUBLE) {
+                *(double*)p = ason_get_number(&v);
+                return ASON_PARSE_OK;
+            }
+            if (!(v.flags & ASON_F_INTEGER)) {
+                /* integral values written as decimals are accepted */
+                d = v.u.num.d;
+                if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0) || (double)(int64_t)d != d)
+                    return ASON_PARSE_INCORRECT_TYPE;
+                v.u.num.i = (int64_t)d;
+            }
+            if (f->type == ASON_FIELD_INT64)
+                *(int64_t*)p = v.u.num.i;
+            else if (v.u.num.i < INT_MIN || v.u.num.i > INT_MAX)
+                return ASON_PARSE_INCORRECT_TYPE;
+            else
+                *(int*)p = (int)v.u.num.i;
+            return ASON_PARSE_OK;
+        case ASON_FIELD_STRING:
+            if (PEEK(c) != '"')
+                return ASON_PARSE_INCORRECT_TYPE;
+            if ((ret = ason_parse_string_raw(c, &s, &len)) != ASON_PARSE_OK)
+                return ret;
+            c->top = head;
+            if (len >= f->size)
+                return ASON_PARSE_INCORRECT_TYPE;
+            memcpy(p, s, len);
+            p[len] = '\0';
+            return ASON_PARSE_OK;
+        case ASON_FIELD_OBJECT:
+            if (PEEK(c) != '{')
+                return ASON_PARSE_INCORRECT_TYPE;
+            return ason_decode_object(c, node->object, p);
+        case ASON_FIELD_ARRAY:
+            if (PEEK(c) != '[')
+                return ASON_PARSE_INCORRECT_TYPE;
+            c->json++;
+            ason_parse_whitespace(c);
+            i = 0;
+            if (PEEK(c) == ']')
+                c->json++;
+            else
+                while (1) {
+                    if (i == f->size)
+                        return ASON_PARSE_INCORRECT_TYPE;
+                    if ((ret = ason_decode_field(c, node->elem, p + i++ * f->stride + node->elem->field->offset)) != ASON_PARSE_OK)
+                        return ret;
+                    ason_parse_whitespace(c);
+                    if (PEEK(c) == ']') {
+                        c->json++;
+                        break;
+                    }
+                    if (PEEK(c) != ',')
+                        return ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                    c->json++;
+                    ason_parse_whitespace(c);
+                }
+            *(size_t*)((char*)p - f->offset + f->count_offset) = i;
+            return ASON_PARSE_OK;
+    }
+    return ASON_PARSE_INCORRECT_TYPE;
+}
+
+static int ason_decode_object(ason_context* c, const ason_schema_object* o, char* out) {
+    const ason_schema_field* node;
+    const char* s;
+    size_t i, len, head = c->top;
+    uint32_t hash;
+    int ret;
+    EXPECT(c, '{');
+    ason_parse_whitespace(c);
+    if (PEEK(c) == '}') {
+        c->json++;
+        return ASON_PARSE_OK;
+    }
+    while (1) {
+        if (PEEK(c) != '"' || ason_parse_string_raw(c, &s, &len) != ASON_PARSE_OK)
+            return ASON_PARSE_MISS_KEY;
+        hash = ason_hash_key(s, len);
+        for (i = hash & o->mask; (node = &o->slots[i])->field != NULL; i = (i + 1) & o->mask)
+            if (node->hash == hash && node->klen == len && memcmp(node->field->key, s, len) == 0)
+                break;
+        c->top = head;
+        ason_parse_whitespace(c);
+        if (PEEK(c) != ':')
+            return ASON_PARSE_MISS_COLON;
+        c->json++;
+        ason_parse_whitespace(c);
+        if (node->field != NULL)
+            ret = ason_decode_field(c, node, out + node->field->offset);
+        else
+            ret = ason_sax_value(c, &ason_skip_handler, NULL);
+        if (ret != ASON_PARSE_OK)
+            return ret;
+        ason_parse_whitespace(c);
+        if (PEEK(c) == '}') {
+            c->json++;
+            return ASON_PARSE_OK;
+        }
+        if (PEEK(c) != ',')
+            return ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        c->json++;
+        ason_parse_whitespace(c);
+    }
+}
+
+int ason_decode_struct(const ason_schema* schema, const char* json, size_t len, void* out) {
+    ason_context c;
+    int ret;
+    assert(schema != NULL && out != NULL && (json != NULL || len == 0));
+    ason_context_init(&c, json, len, 0);
+    ason_parse_whitespace(&c);
+    if (PEEK(&c) == '\0')
+        ret = ASON_PARSE_EXPECT_VALUE;
+    else if (PEEK(&c) != '{')
+        ret = ASON_PARSE_INCORRECT_TYPE;
+    else if ((ret = ason_decode_object(&c, schema->root, (char*)out)) == ASON_PARSE_OK) {
+        ason_parse_whitespace(&c);
+        if (c.json != c.end)
+            ret = ASON_PARSE_ROOT_NOT_SINGULAR;
+    }
+    ASON_FREE(c.stack);
+    return ret;
 }
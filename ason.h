@@ -1,6 +1,9 @@
 #ifndef ASON_H__
 #define ASON_H__
 
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* int64_t */
+
 typedef enum {
     ASON_NULL,
     ASON_FALSE,
@@ -13,9 +16,15 @@ typedef enum {
 
 typedef struct ason_value ason_value;
 typedef struct ason_entry ason_entry;
+typedef struct ason_document ason_document;
+typedef struct ason_parser ason_parser;
+typedef struct ason_ondemand_doc ason_ondemand_doc;
+typedef struct ason_path ason_path;
+typedef struct ason_writer ason_writer;
 
-typedef struct {
+typedef union {
     double d;
+    int64_t i; /* when ason_is_integer() */
 } ason_number;
 
 typedef struct {
@@ -23,24 +32,18 @@ typedef struct {
     size_t len;
 } ason_string;
 
-typedef struct {
-    ason_value* m;
-    size_t size;
-} ason_array;
-
-typedef struct {
-    ason_entry* e;
-    size_t size;
-} ason_object;
-
+/* 16 bytes; short strings are stored in the value itself, see ason.c */
 struct ason_value {
     union {
         ason_number num;
-        ason_string str;
-        ason_array  arr;
-        ason_object obj;
+        char* s;
+        ason_value* m;
+        ason_entry* e;
     } u;
-    ason_type type;
+    uint32_t size_lo;    /* string length, array size or object entry count, */
+    uint16_t size_hi;    /* split so that the tags below fit in the padding */
+    unsigned char type;  /* ason_type */
+    unsigned char flags; /* internal representation bits, see ason.c */
 };
 
 struct ason_entry {
@@ -62,12 +65,168 @@ enum {
     ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
     ASON_PARSE_MISS_KEY,
     ASON_PARSE_MISS_COLON,
-    ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET
+    ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+    ASON_PARSE_ABORTED,
+    ASON_PARSE_INCORRECT_TYPE,
+    ASON_PARSE_NOT_FOUND,
+    ASON_PARSE_DEPTH_EXCEEDED, /* nesting deeper than ASON_PARSE_MAX_DEPTH */
+    ASON_PARSE_INVALID_UTF8    /* with ASON_PARSE_VALIDATE_UTF8 */
 };
 
-#define ason_init(v) do {(v)->type = ASON_NULL;} while(0)
+/* parse flags */
+#define ASON_PARSE_PADDED 0x1 /* ASON_PADDING readable bytes (of any value) follow json[len] */
+#define ASON_PARSE_INTERN_KEYS 0x2 /* equal object keys share one immutable buffer */
+#define ASON_PARSE_VALIDATE_UTF8 0x4 /* strings must be well-formed UTF-8, invalid bytes are passed through otherwise */
+#define ASON_PARSE_RAW_NUMBERS 0x8 /* numbers keep their text in json, which must outlive them but not an ason_copy; converted when read and by ason_encode_binary */
+
+#define ASON_PADDING 8
+
+/*
+ * All memory comes from the global allocator: values, strings, parse stacks and the
+ * buffers returned to the caller. Set it before anything is allocated. realloc_fn and
+ * free_fn take NULL as realloc and free do.
+ */
+typedef struct {
+    void* (*malloc_fn)(void* user, size_t size);
+    void* (*realloc_fn)(void* user, void* ptr, size_t size);
+    void (*free_fn)(void* user, void* ptr);
+    void* user;
+} ason_allocator;
+
+/* NULL restores malloc, realloc and free */
+void ason_set_allocator(const ason_allocator* allocator);
+const ason_allocator* ason_get_allocator(void);
+
+#define ason_init(v) do {(v)->type = ASON_NULL; (v)->flags = 0;} while(0)
 
 int ason_parse(ason_value* v, const char* json);
+int ason_parse_n(ason_value* v, const char* json, size_t len);
+int ason_parse_ex(ason_value* v, const char* json, size_t len, unsigned flags);
+/* strings point into json, which is modified and must outlive v */
+int ason_parse_insitu(ason_value* v, char* json, size_t len);
+/* what ason_parse_ex(v, json, len, ASON_PARSE_VALIDATE_UTF8) returns, without allocating */
+int ason_validate(const char* json, size_t len);
+
+/* return 0 to stop the parse with ASON_PARSE_ABORTED; NULL callbacks are skipped */
+typedef struct {
+    int (*null)(void* ctx);
+    int (*boolean)(void* ctx, int b);
+    int (*number)(void* ctx, double d);
+    int (*integer)(void* ctx, int64_t i); /* integers go to number when NULL */
+    int (*string)(void* ctx, const char* s, size_t len);
+    int (*start_object)(void* ctx);
+    int (*key)(void* ctx, const char* s, size_t len);
+    int (*end_object)(void* ctx, size_t count);
+    int (*start_array)(void* ctx);
+    int (*end_array)(void* ctx, size_t count);
+} ason_sax_handler;
+
+/* strings are only valid during the callback */
+int ason_parse_sax(const ason_sax_handler* handler, void* ctx, const char* json, size_t len);
+
+/* push parser: feed a document in chunks of any size, finish yields it and readies the next one */
+ason_parser* ason_parser_create(void);
+void ason_parser_destroy(ason_parser* p);
+int ason_parser_feed(ason_parser* p, const char* chunk, size_t len);
+int ason_parser_finish(ason_parser* p, ason_value* v);
+/* a whole document at once; the scratch stack keeps its size between calls, a pending feed is dropped */
+int ason_parser_parse(ason_parser* p, ason_value* v, const char* json, size_t len);
+/* frees the scratch buffers that are not in use */
+void ason_parser_shrink(ason_parser* p);
+
+/* one entry per non-blank line, in input order; a line that failed has its error and a null value */
+typedef struct {
+    ason_value* values;
+    int* errors;
+    size_t* lines; /* line numbers, from 1 */
+    size_t count;
+} ason_ndjson;
+
+/* returns the first error in input order, or ASON_PARSE_OK */
+int ason_parse_ndjson(ason_ndjson* out, const char* json, size_t len, int nthreads);
+void ason_ndjson_free(ason_ndjson* r);
+
+/*
+ * on-demand: parse only indexes json, which must outlive the doc; values are decoded when read.
+ * Strings from get_string stay valid until the doc is parsed again or freed.
+ */
+typedef struct {
+    ason_ondemand_doc* doc;
+    size_t i;
+} ason_ondemand_value;
+
+typedef struct {
+    ason_ondemand_doc* doc;
+    size_t i;
+    int started;
+} ason_ondemand_iter;
+
+ason_ondemand_doc* ason_ondemand_create(void);
+void ason_ondemand_free(ason_ondemand_doc* d);
+int ason_ondemand_parse(ason_ondemand_doc* d, const char* json, size_t len);
+void ason_ondemand_root(ason_ondemand_doc* d, ason_ondemand_value* v);
+ason_type ason_ondemand_get_type(const ason_ondemand_value* v);
+/* ASON_PARSE_NOT_FOUND when the key is missing or the array has no more elements */
+int ason_ondemand_find_field(const ason_ondemand_value* obj, const char* key, size_t klen, ason_ondemand_value* out);
+int ason_ondemand_array_iter(const ason_ondemand_value* arr, ason_ondemand_iter* it);
+int ason_ondemand_next(ason_ondemand_iter* it, ason_ondemand_value* out);
+int ason_ondemand_get_double(const ason_ondemand_value* v, double* n);
+int ason_ondemand_get_string(const ason_ondemand_value* v, const char** s, size_t* len);
+int ason_ondemand_get_value(const ason_ondemand_value* v, ason_value* out);
+
+char* ason_stringify(const ason_value* v, size_t* length);
+size_t ason_stringify_buffer(const ason_value* v, char** buffer, size_t* capacity);
+
+/*
+ * Streaming writer: output goes through a fixed buffer to write_fn, or to fd with writev,
+ * without building values. A call out of place (a value where a key is due, an end that
+ * does not match) fails with ASON_PARSE_INCORRECT_TYPE, a failed write with
+ * ASON_PARSE_ABORTED, and every call after an error returns it. Top-level values are
+ * separated by '\n'.
+ */
+typedef int (*ason_write_func)(void* user, const char* s, size_t len); /* 0 on failure */
+
+ason_writer* ason_writer_create(ason_write_func write_fn, void* user);
+ason_writer* ason_writer_create_fd(int fd); /* not built with ASON_NO_WRITEV */
+void ason_writer_destroy(ason_writer* w);
+int ason_writer_start_object(ason_writer* w);
+int ason_writer_key(ason_writer* w, const char* s, size_t len);
+int ason_writer_end_object(ason_writer* w);
+int ason_writer_start_array(ason_writer* w);
+int ason_writer_end_array(ason_writer* w);
+int ason_writer_null(ason_writer* w);
+int ason_writer_boolean(ason_writer* w, int b);
+int ason_writer_number(ason_writer* w, double d);
+int ason_writer_int(ason_writer* w, int64_t i);
+int ason_writer_string(ason_writer* w, const char* s, size_t len);
+/* json is written as it is, as one value */
+int ason_writer_raw(ason_writer* w, const char* json, size_t len);
+int ason_writer_flush(ason_writer* w);
+/* flushes, fails if a container is still open, and readies the writer for the next output */
+int ason_writer_finish(ason_writer* w);
+
+/*
+ * ASON binary: arrays carry offset tables and objects a key-sorted index, so a view
+ * reads the bytes in place. Buffers are limited to 4 GiB, encode returns NULL beyond.
+ * open checks the header only, the rest must come from ason_encode_binary.
+ */
+typedef struct {
+    const unsigned char* p;
+} ason_binary_view;
+
+char* ason_encode_binary(const ason_value* v, size_t* length);
+int ason_binary_open(ason_binary_view* root, const void* data, size_t length);
+ason_type ason_binary_get_type(const ason_binary_view* v);
+int ason_binary_is_integer(const ason_binary_view* v);
+double ason_binary_get_number(const ason_binary_view* v);
+int64_t ason_binary_get_integer(const ason_binary_view* v);
+const char* ason_binary_get_string(const ason_binary_view* v, size_t* length);
+size_t ason_binary_get_size(const ason_binary_view* v);
+void ason_binary_get_element(const ason_binary_view* v, size_t index, ason_binary_view* out);
+const char* ason_binary_get_key(const ason_binary_view* v, size_t index, size_t* length);
+void ason_binary_get_value(const ason_binary_view* v, size_t index, ason_binary_view* out);
+size_t ason_binary_find_key(const ason_binary_view* v, const char* key, size_t klen);
+void ason_binary_to_value(const ason_binary_view* v, ason_value* out);
 
 void ason_free(ason_value* v);
 
@@ -80,18 +239,106 @@ void ason_set_boolean(ason_value* v, int b);
 
 double ason_get_number(const ason_value* v);
 void ason_set_number(ason_value* v, double n);
+int ason_is_integer(const ason_value* v);
+int64_t ason_get_integer(const ason_value* v);
+/* the input text of a number parsed with ASON_PARSE_RAW_NUMBERS, NULL for others */
+const char* ason_get_number_text(const ason_value* v, size_t* length);
+void ason_set_integer(ason_value* v, int64_t i);
 
 const char* ason_get_string(const ason_value* v);
 size_t ason_get_string_length(const ason_value* v);
 void ason_new_string(ason_string* str, const char* s, size_t len);
 void ason_set_string(ason_value* v, const char* s, size_t len);
 
+/* capacities grow by doubling; containers from a document cannot be resized */
+void ason_set_array(ason_value* v, size_t capacity);
 size_t ason_get_array_size(const ason_value* v);
+size_t ason_get_array_capacity(const ason_value* v);
+void ason_reserve_array(ason_value* v, size_t capacity);
+void ason_shrink_array(ason_value* v);
+void ason_clear_array(ason_value* v);
 ason_value* ason_get_array_element(const ason_value* v, size_t index);
+ason_value* ason_pushback_array_element(ason_value* v);
+void ason_popback_array_element(ason_value* v);
+ason_value* ason_insert_array_element(ason_value* v, size_t index);
+void ason_erase_array_element(ason_value* v, size_t index, size_t count);
 
+void ason_set_object(ason_value* v, size_t capacity);
 size_t ason_get_object_entry_size(const ason_value* v);
+size_t ason_get_object_capacity(const ason_value* v);
+void ason_reserve_object(ason_value* v, size_t capacity);
+void ason_shrink_object(ason_value* v);
+void ason_clear_object(ason_value* v);
 const char* ason_get_object_key(const ason_value* v, size_t index);
 size_t ason_get_object_key_length(const ason_value* v, size_t index);
 ason_value* ason_get_object_value(const ason_value* v, size_t index);
+/* the first entry with the key; large objects build a hash index, so do not race the first lookup */
+#define ASON_KEY_NOT_EXIST ((size_t)-1)
+size_t ason_find_object_index(const ason_value* v, const char* key, size_t klen);
+ason_value* ason_find_object_value(const ason_value* v, const char* key, size_t klen);
+/* the value under key, a new null one appended when there is none */
+ason_value* ason_set_object_value(ason_value* v, const char* key, size_t klen);
+void ason_remove_object_value(ason_value* v, size_t index);
+
+void ason_move(ason_value* dst, ason_value* src);
+void ason_swap(ason_value* lhs, ason_value* rhs);
+void ason_copy(ason_value* dst, const ason_value* src);
+/* key order does not matter, except between duplicates of one key, and numbers compare by exact value; the hash is stable across runs and platforms */
+int ason_is_equal(const ason_value* lhs, const ason_value* rhs);
+uint64_t ason_hash(const ason_value* v);
+
+/* JSON Pointer (RFC 6901), compile returns NULL when the pointer is malformed */
+ason_path* ason_path_compile(const char* pointer);
+void ason_path_free(ason_path* path);
+ason_value* ason_path_eval(const ason_path* path, const ason_value* v);
+/* ASON_PARSE_NOT_FOUND when missing; only the text on the way to the target and the target are validated */
+int ason_path_eval_text(const ason_path* path, const char* json, size_t len, ason_value* v);
+
+/*
+ * Struct decoding: a field list describes a C struct, a NULL key ends it.
+ * An ASON_FIELD_ARRAY holds up to size elements stride bytes apart, fields[0]
+ * describes each one (its offset is within the element) and the element count
+ * is stored in the size_t at count_offset.
+ */
+typedef enum {
+    ASON_FIELD_BOOL,   /* int */
+    ASON_FIELD_INT,    /* int */
+    ASON_FIELD_INT64,  /* int64_t */
+    ASON_FIELD_DOUBLE, /* double */
+    ASON_FIELD_STRING, /* char[size], '\0' terminated */
+    ASON_FIELD_OBJECT, /* struct described by fields */
+    ASON_FIELD_ARRAY
+} ason_field_type;
+
+typedef struct ason_field ason_field;
+typedef struct ason_schema ason_schema;
+
+struct ason_field {
+    const char* key;
+    ason_field_type type;
+    size_t offset;
+    size_t size;
+    const ason_field* fields;
+    size_t stride;
+    size_t count_offset;
+};
+
+ason_schema* ason_schema_compile(const ason_field* fields);
+void ason_schema_free(ason_schema* schema);
+/*
+ * json must be an object. Unknown members are skipped, missing ones and nulls leave
+ * out as it is. Values that do not fit their field fail with ASON_PARSE_INCORRECT_TYPE.
+ */
+int ason_decode_struct(const ason_schema* schema, const char* json, size_t len, void* out);
+
+/* all nodes and strings live in the document's arena, change them with ason_document_set_* only */
+ason_document* ason_document_create(void);
+/* the document, its arena and its parses use allocator, NULL for the global one */
+ason_document* ason_document_create_ex(const ason_allocator* allocator);
+void ason_document_free(ason_document* doc);
+int ason_document_parse(ason_document* doc, const char* json);
+int ason_document_parse_ex(ason_document* doc, const char* json, size_t len, unsigned flags);
+ason_value* ason_document_root(ason_document* doc);
+void ason_document_set_string(ason_document* doc, ason_value* v, const char* s, size_t len);
 
 #endif
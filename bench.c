@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include "ason.h"
+
+/*
+ * ason_bench [output.json]
+ * Generates its corpora, so runs are comparable across machines and releases,
+ * and writes one JSON report. Build with optimization, e.g. CMAKE_BUILD_TYPE=Release.
+ */
+
+#define BENCH_MIN_SECONDS 0.25 /* timed per operation */
+#define BENCH_MAX_SECONDS 2.0  /* spent per operation, including untimed setup */
+#define BENCH_HEADER 16        /* keeps the hooked blocks as aligned as malloc's */
+
+/* counting allocator, installed with ason_set_allocator */
+static size_t bench_allocs = 0;
+static size_t bench_live = 0;
+static size_t bench_peak = 0;
+
+static void* bench_track(char* p, size_t size) {
+    if (p == NULL)
+        return NULL;
+    *(size_t*)p = size;
+    bench_allocs++;
+    bench_live += size;
+    if (bench_live > bench_peak)
+        bench_peak = bench_live;
+    return p + BENCH_HEADER;
+}
+
+static void* bench_malloc(void* user, size_t size) {
+    (void)user;
+    return bench_track((char*)malloc(BENCH_HEADER + size), size);
+}
+
+static void* bench_realloc(void* user, void* ptr, size_t size) {
+    char* p;
+    if (ptr == NULL)
+        return bench_malloc(user, size);
+    p = (char*)ptr - BENCH_HEADER;
+    bench_live -= *(size_t*)p;
+    return bench_track((char*)realloc(p, BENCH_HEADER + size), size);
+}
+
+static void bench_free_block(void* user, void* ptr) {
+    (void)user;
+    if (ptr != NULL) {
+        bench_live -= *(size_t*)((char*)ptr - BENCH_HEADER);
+        free((char*)ptr - BENCH_HEADER);
+    }
+}
+
+/* corpus generation */
+typedef struct {
+    char* p;
+    size_t len, cap;
+} bench_buffer;
+
+static void bench_puts(bench_buffer* b, const char* s) {
+    size_t len = strlen(s);
+    if (b->len + len + 1 > b->cap) {
+        while (b->len + len + 1 > b->cap)
+            b->cap = b->cap ? b->cap * 2 : 4096;
+        b->p = (char*)realloc(b->p, b->cap);
+    }
+    memcpy(b->p + b->len, s, len + 1);
+    b->len += len;
+}
+
+static void bench_printf(bench_buffer* b, const char* format, ...) {
+    char s[512];
+    va_list args;
+    va_start(args, format);
+    vsprintf(s, format, args);
+    va_end(args);
+    bench_puts(b, s);
+}
+
+static unsigned long bench_seed = 1;
+
+static unsigned long bench_rand(unsigned long n) {
+    bench_seed = (bench_seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+    return (bench_seed >> 8) % n;
+}
+
+static const char* bench_words[] = {
+    "json", "fast", "parser", "\\u3042\\u3044", "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E", "tweet", "line\\nbreak",
+    "\\\"quoted\\\"", "http:\\/\\/t.co\\/abc", "@ason", "#benchmark", "caf\xC3\xA9", "the", "a", "of"
+};
+
+static void bench_text(bench_buffer* b, size_t words) {
+    size_t i;
+    bench_puts(b, "\"");
+    for (i = 0; i < words; i++) {
+        if (i > 0)
+            bench_puts(b, " ");
+        bench_puts(b, bench_words[bench_rand(sizeof(bench_words) / sizeof(bench_words[0]))]);
+    }
+    bench_puts(b, "\"");
+}
+
+/* string-heavy, shaped like twitter.json */
+static void bench_twitter(bench_buffer* b) {
+    size_t i;
+    unsigned long id;
+    bench_puts(b, "{\"statuses\":[");
+    for (i = 0; i < 2000; i++) {
+        id = 505874924UL + bench_rand(1000000);
+        bench_printf(b, "%s{\"created_at\":\"Sun Aug 31 00:%02lu:%02lu +0000 2014\",\"id\":%lu%09lu,\"id_str\":\"%lu%09lu\",\"text\":",
+            i ? "," : "", bench_rand(60), bench_rand(60), id, (unsigned long)i, id, (unsigned long)i);
+        bench_text(b, 8 + bench_rand(16));
+        bench_printf(b, ",\"user\":{\"id\":%lu,\"name\":", bench_rand(2000000000UL));
+        bench_text(b, 2);
+        bench_printf(b, ",\"screen_name\":\"user%lu\",\"description\":", bench_rand(100000));
+        bench_text(b, 4 + bench_rand(12));
+        bench_printf(b, ",\"followers_count\":%lu,\"verified\":%s,\"profile_image_url\":\"http:\\/\\/pbs.twimg.com\\/profile_images\\/%lu\\/normal.jpeg\"},"
+            "\"entities\":{\"hashtags\":[],\"urls\":[],\"user_mentions\":[{\"screen_name\":\"user%lu\",\"indices\":[0,%lu]}]},"
+            "\"retweet_count\":%lu,\"favorited\":false,\"lang\":\"ja\",\"in_reply_to_status_id\":null}",
+            bench_rand(100000), bench_rand(10) ? "false" : "true", bench_rand(1000000000UL), bench_rand(100000), 4 + bench_rand(12), bench_rand(1000));
+    }
+    bench_puts(b, "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,\"query\":\"%E4%B8%80\",\"count\":2000}}");
+}
+
+/* number-heavy, shaped like canada.json */
+static void bench_canada(bench_buffer* b) {
+    size_t i, j;
+    bench_puts(b, "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},"
+        "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[");
+    for (i = 0; i < 60; i++) {
+        bench_puts(b, i ? ",[" : "[");
+        for (j = 0; j < 1000; j++)
+            bench_printf(b, "%s[-%lu.%09lu%lu,%lu.%09lu%lu]", j ? "," : "",
+                50 + bench_rand(90), bench_rand(1000000000UL), bench_rand(10000000UL),
+                40 + bench_rand(40), bench_rand(1000000000UL), bench_rand(10000000UL));
+        bench_puts(b, "]");
+    }
+    bench_puts(b, "]}}]}");
+}
+
+/* object-heavy, shaped like citm_catalog.json */
+static void bench_citm(bench_buffer* b) {
+    size_t i;
+    bench_puts(b, "{\"areaNames\":{");
+    for (i = 0; i < 200; i++)
+        bench_printf(b, "%s\"%lu\":\"Arri\xC3\xA8re-sc\xC3\xA8ne %lu\"", i ? "," : "", 205705993UL + i, (unsigned long)i);
+    bench_puts(b, "},\"events\":{");
+    for (i = 0; i < 2000; i++)
+        bench_printf(b, "%s\"%lu\":{\"description\":null,\"id\":%lu,\"logo\":%s,\"name\":\"Event %lu\","
+            "\"subTopicIds\":[337184269,337184283],\"subjectCode\":null,\"subtitle\":null,\"topicIds\":[324846099,%lu]}",
+            i ? "," : "", 138586341UL + i, 138586341UL + i, bench_rand(2) ? "null" : "\"\\/images\\/UE0AAAAACEKo6QAAAAZDSVRN\"",
+            (unsigned long)i, 107888604UL + bench_rand(100));
+    bench_puts(b, "},\"performances\":[");
+    for (i = 0; i < 2000; i++)
+        bench_printf(b, "%s{\"eventId\":%lu,\"id\":%lu,\"logo\":null,\"name\":null,"
+            "\"prices\":[{\"amount\":%lu,\"audienceSubCategoryId\":337100890,\"seatCategoryId\":338937295},"
+            "{\"amount\":%lu,\"audienceSubCategoryId\":337100890,\"seatCategoryId\":338937296}],"
+            "\"seatCategories\":[{\"areas\":[{\"areaId\":%lu,\"blockIds\":[]},{\"areaId\":%lu,\"blockIds\":[]}],\"seatCategoryId\":338937295}],"
+            "\"seatMapImage\":null,\"start\":%lu000,\"venueCode\":\"PLEYEL_PLEYEL\"}",
+            i ? "," : "", 138586341UL + bench_rand(2000), 339887544UL + i, 10000 + bench_rand(90000), 10000 + bench_rand(90000),
+            205705993UL + bench_rand(200), 205705993UL + bench_rand(200), 1372701600UL + bench_rand(10000000UL));
+    bench_puts(b, "]}");
+}
+
+/* deep nesting */
+static void bench_deep(bench_buffer* b) {
+    size_t i, j;
+    bench_puts(b, "[");
+    for (i = 0; i < 200; i++) {
+        bench_puts(b, i ? "," : "");
+        for (j = 0; j < 500; j++)
+            bench_puts(b, j % 2 ? "{\"a\":" : "[");
+        bench_printf(b, "%lu", (unsigned long)i);
+        for (j = 500; j-- > 0; )
+            bench_puts(b, j % 2 ? "}" : "]");
+    }
+    bench_puts(b, "]");
+}
+
+/* one small record per line */
+static void bench_ndjson(bench_buffer* b) {
+    size_t i;
+    for (i = 0; i < 20000; i++)
+        bench_printf(b, "{\"id\":%lu,\"name\":\"user %lu\",\"score\":%lu.%02lu,\"tags\":[\"a\",\"b\"],\"active\":%s}\n",
+            (unsigned long)i, bench_rand(100000), bench_rand(100), bench_rand(100), bench_rand(2) ? "true" : "false");
+}
+
+/* measurement */
+typedef struct {
+    const char* name;
+    void (*generate)(bench_buffer* b);
+    int ndjson;
+    bench_buffer json;
+    size_t documents;
+} bench_corpus;
+
+typedef struct {
+    double seconds; /* per run */
+    size_t allocs, peak_bytes;
+} bench_result;
+
+typedef struct {
+    ason_value v;
+    ason_ndjson nd;
+} bench_doc;
+
+static void bench_parse(bench_corpus* c, bench_doc* d) {
+    int ret;
+    ason_init(&d->v);
+    if (c->ndjson)
+        ret = ason_parse_ndjson(&d->nd, c->json.p, c->json.len, 1);
+    else
+        ret = ason_parse_n(&d->v, c->json.p, c->json.len);
+    if (ret != ASON_PARSE_OK) {
+        fprintf(stderr, "ason_bench: %s does not parse: %d\n", c->name, ret);
+        exit(1);
+    }
+    if (c->ndjson)
+        c->documents = d->nd.count;
+}
+
+static void bench_free(bench_corpus* c, bench_doc* d) {
+    if (c->ndjson)
+        ason_ndjson_free(&d->nd);
+    else
+        ason_free(&d->v);
+}
+
+static void bench_stringify(bench_corpus* c, bench_doc* d) {
+    size_t i;
+    if (c->ndjson)
+        for (i = 0; i < d->nd.count; i++)
+            bench_free_block(NULL, ason_stringify(&d->nd.values[i], NULL));
+    else
+        bench_free_block(NULL, ason_stringify(&d->v, NULL));
+}
+
+/* ndjson is checked line by line, as a gateway would see it */
+static void bench_validate(bench_corpus* c) {
+    const char *p = c->json.p, *end = p + c->json.len, *eol;
+    int ret = ASON_PARSE_OK;
+    if (!c->ndjson)
+        ret = ason_validate(p, c->json.len);
+    else
+        for (; p < end && ret == ASON_PARSE_OK; p = eol + 1) {
+            if ((eol = (const char*)memchr(p, '\n', (size_t)(end - p))) == NULL)
+                eol = end;
+            if (eol != p)
+                ret = ason_validate(p, (size_t)(eol - p));
+        }
+    if (ret != ASON_PARSE_OK) {
+        fprintf(stderr, "ason_bench: %s does not validate: %d\n", c->name, ret);
+        exit(1);
+    }
+}
+
+enum { BENCH_PARSE, BENCH_FREE, BENCH_STRINGIFY, BENCH_VALIDATE, BENCH_OPS };
+static const char* bench_op_names[BENCH_OPS] = { "parse", "free", "stringify", "validate" };
+
+/* one counted run, then timed runs; parse and free set each other up outside the timing */
+static void bench_run(bench_corpus* c, int op, bench_result* r) {
+    bench_doc d;
+    clock_t start, spent = 0, total = clock();
+    size_t runs = 0, base;
+
+    if (op != BENCH_PARSE)
+        bench_parse(c, &d);
+    base = bench_peak = bench_live;
+    bench_allocs = 0;
+    switch (op) {
+        case BENCH_PARSE:     bench_parse(c, &d); break;
+        case BENCH_FREE:      bench_free(c, &d); break;
+        case BENCH_STRINGIFY: bench_stringify(c, &d); break;
+        case BENCH_VALIDATE:  bench_validate(c); break;
+    }
+    r->allocs = bench_allocs;
+    r->peak_bytes = bench_peak - base;
+    if (op != BENCH_FREE)
+        bench_free(c, &d);
+
+    if (op == BENCH_STRINGIFY)
+        bench_parse(c, &d);
+    do {
+        if (op == BENCH_FREE)
+            bench_parse(c, &d);
+        start = clock();
+        switch (op) {
+            case BENCH_PARSE:     bench_parse(c, &d); break;
+            case BENCH_FREE:      bench_free(c, &d); break;
+            case BENCH_STRINGIFY: bench_stringify(c, &d); break;
+            case BENCH_VALIDATE:  bench_validate(c); break;
+        }
+        spent += clock() - start;
+        runs++;
+        if (op == BENCH_PARSE)
+            bench_free(c, &d);
+    } while (spent < BENCH_MIN_SECONDS * CLOCKS_PER_SEC && clock() - total < BENCH_MAX_SECONDS * CLOCKS_PER_SEC);
+    if (op == BENCH_STRINGIFY)
+        bench_free(c, &d);
+    r->seconds = (double)spent / CLOCKS_PER_SEC / runs;
+}
+
+int main(int argc, char* argv[]) {
+    ason_allocator allocator = { bench_malloc, bench_realloc, bench_free_block, NULL };
+    bench_corpus corpora[] = {
+        { "twitter", bench_twitter, 0, { NULL, 0, 0 }, 0 },
+        { "canada",  bench_canada,  0, { NULL, 0, 0 }, 0 },
+        { "citm_catalog", bench_citm, 0, { NULL, 0, 0 }, 0 },
+        { "deep",    bench_deep,    0, { NULL, 0, 0 }, 0 },
+        { "ndjson",  bench_ndjson,  1, { NULL, 0, 0 }, 0 }
+    };
+    size_t i, n = sizeof(corpora) / sizeof(corpora[0]);
+    bench_result r;
+    FILE* out = stdout;
+    int op;
+
+    ason_set_allocator(&allocator);
+    if (argc > 1 && (out = fopen(argv[1], "w")) == NULL) {
+        fprintf(stderr, "ason_bench: cannot write %s\n", argv[1]);
+        return 1;
+    }
+    fprintf(out, "{\"benchmark\":\"ason\",\"corpora\":[");
+    for (i = 0; i < n; i++) {
+        corpora[i].generate(&corpora[i].json);
+        corpora[i].documents = 1;
+        fprintf(out, "%s\n{\"name\":\"%s\",\"bytes\":%lu", i ? "," : "", corpora[i].name, (unsigned long)corpora[i].json.len);
+        for (op = 0; op < BENCH_OPS; op++) {
+            bench_run(&corpora[i], op, &r);
+            fprintf(out, ",\"%s\":{\"seconds\":%.9f,\"mb_per_s\":%.3f,\"documents_per_s\":%.3f,\"allocs\":%lu,\"peak_bytes\":%lu}",
+                bench_op_names[op], r.seconds, corpora[i].json.len / r.seconds / 1e6, corpora[i].documents / r.seconds,
+                (unsigned long)r.allocs, (unsigned long)r.peak_bytes);
+            fprintf(stderr, "%-13s %-10s %10.2f MB/s %10lu allocs %12lu peak bytes\n", corpora[i].name, bench_op_names[op],
+                corpora[i].json.len / r.seconds / 1e6, (unsigned long)r.allocs, (unsigned long)r.peak_bytes);
+        }
+        fprintf(out, ",\"documents\":%lu}", (unsigned long)corpora[i].documents);
+        free(corpora[i].json.p);
+    }
+    fprintf(out, "\n]}\n");
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
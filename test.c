@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef ASON_NO_WRITEV
+#include <unistd.h>
+#endif
 #include "ason.h"
 
 static int main_ret = 0;
@@ -63,6 +66,7 @@ static void test_parse_true() {
         EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, json)); \
         EXPECT_EQ_INT(ASON_NUMBER, ason_get_type(&v)); \
         EXPECT_EQ_DOUBLE(expect, ason_get_number(&v)); \
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_validate(json, strlen(json))); \
         ason_free(&v); \
     } while(0)
 
@@ -97,6 +101,54 @@ static void test_parse_number() {
     TEST_NUMBER(-2.2250738585072014e-308, "-2.2250738585072014e-308");
     TEST_NUMBER( 1.7976931348623157e+308, "1.7976931348623157e+308");  /* Max double */
     TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
+
+    /* beyond the 19 digits kept in the significand */
+    TEST_NUMBER(1e19, "10000000000000000000");
+    TEST_NUMBER(18446744073709551616.0, "18446744073709551616");
+    TEST_NUMBER(0.1, "0.1000000000000000000000000000001");
+    TEST_NUMBER(1.7976931348623157e+308, "179769313486231570000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000.0");
+    TEST_NUMBER(1e-300, "0.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001");
+    /* halfway cases that need the exact fallback */
+    TEST_NUMBER(9007199254740992.0, "9007199254740993");
+    TEST_NUMBER(9007199254740994.0, "9007199254740993.0000000001e0");
+    TEST_NUMBER(2.2250738585072011e-308, "2.2250738585072011e-308");
+    TEST_NUMBER(0.0, "1e-400000000000");
+}
+
+#define TEST_INTEGER(expect, json) \
+    do { \
+        ason_value v; \
+        ason_init(&v); \
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, json)); \
+        EXPECT_EQ_INT(ASON_NUMBER, ason_get_type(&v)); \
+        EXPECT_TRUE(ason_is_integer(&v)); \
+        EXPECT_TRUE((expect) == ason_get_integer(&v)); \
+        ason_free(&v); \
+    } while(0)
+
+static void test_parse_integer() {
+    ason_value v;
+    TEST_INTEGER(0, "0");
+    TEST_INTEGER(1, "1");
+    TEST_INTEGER(-1, "-1");
+    TEST_INTEGER(1234567890, "1234567890");
+    TEST_INTEGER(9007199254740993, "9007199254740993"); /* 2^53 + 1, not a double */
+    TEST_INTEGER(INT64_MAX, "9223372036854775807");
+    TEST_INTEGER(INT64_MIN, "-9223372036854775808");
+
+    /* out of int64 range, or not written as an integer: double */
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, "9223372036854775808"));
+    EXPECT_FALSE(ason_is_integer(&v));
+    EXPECT_EQ_DOUBLE(9223372036854775808.0, ason_get_number(&v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, "-0"));
+    EXPECT_FALSE(ason_is_integer(&v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, "1.0"));
+    EXPECT_FALSE(ason_is_integer(&v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, "1e2"));
+    EXPECT_FALSE(ason_is_integer(&v));
+    EXPECT_EQ_DOUBLE(100.0, ason_get_number(&v));
+    ason_free(&v);
 }
 
 #define TEST_STRING(expect, json) \
@@ -230,6 +282,7 @@ static void test_parse_object() {
         ason_set_boolean(&v, 0); \
         EXPECT_EQ_INT(error, ason_parse(&v, json)); \
         EXPECT_EQ_INT(ASON_NULL, ason_get_type(&v)); \
+        EXPECT_EQ_INT(error, ason_validate(json, strlen(json))); \
         ason_free(&v); \
     } while(0)
 
@@ -342,6 +395,118 @@ static void test_parse_miss_comma_or_curly_bracket() {
     TEST_ERROR(ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+#define TEST_ROUNDTRIP(json) \
+    do { \
+        ason_value v; \
+        char* json2; \
+        size_t length; \
+        ason_init(&v); \
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, json)); \
+        json2 = ason_stringify(&v, &length); \
+        EXPECT_EQ_STRING(json, json2, length); \
+        ason_free(&v); \
+        free(json2); \
+    } while(0)
+
+static void test_stringify_number() {
+    static const double values[] = {
+        0.0, 1.0, -1.0, 1.5, 3.1416, 1e10, 1.234e-10, 0.1, 1.0 / 3.0, 123456789.0,
+        1.0000000000000002, 4.9406564584124654e-324, 2.2250738585072009e-308,
+        2.2250738585072014e-308, 1.7976931348623157e+308, 5e-7, 1e21, 1e22, 9007199254740993.0
+    };
+    size_t i;
+    TEST_ROUNDTRIP("-0.0");
+    TEST_ROUNDTRIP("1.5");
+    TEST_ROUNDTRIP("-1.5");
+    TEST_ROUNDTRIP("3.25");
+    TEST_ROUNDTRIP("0.001234");
+    TEST_ROUNDTRIP("1e30");
+    TEST_ROUNDTRIP("1.234e-20");
+    TEST_ROUNDTRIP("1.0000000000000002");
+    TEST_ROUNDTRIP("5e-324");
+    TEST_ROUNDTRIP("1.7976931348623157e308");
+    TEST_ROUNDTRIP("-1.7976931348623157e308");
+    /* shortest output must still read back as the very same double */
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        ason_value v, v2;
+        char* json;
+        ason_init(&v);
+        ason_init(&v2);
+        ason_set_number(&v, values[i]);
+        json = ason_stringify(&v, NULL);
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v2, json));
+        EXPECT_EQ_DOUBLE(values[i], ason_get_number(&v2));
+        ason_free(&v);
+        ason_free(&v2);
+        free(json);
+    }
+}
+
+static void test_stringify_integer() {
+    TEST_ROUNDTRIP("0");
+    TEST_ROUNDTRIP("-1");
+    TEST_ROUNDTRIP("1234567890123");
+    TEST_ROUNDTRIP("9223372036854775807");
+    TEST_ROUNDTRIP("-9223372036854775808");
+}
+
+static void test_stringify_string() {
+    TEST_ROUNDTRIP("\"\"");
+    TEST_ROUNDTRIP("\"Hello\"");
+    TEST_ROUNDTRIP("\"Hello\\nWorld\"");
+    TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+    TEST_ROUNDTRIP("\"Hello\\u0000World\"");
+    TEST_ROUNDTRIP("\"\\u001F\xE2\x82\xAC\"");
+}
+
+static void test_stringify_array() {
+    TEST_ROUNDTRIP("[]");
+    TEST_ROUNDTRIP("[null,false,true,123.0,\"abc\",[1.5,2.5,3.5]]");
+}
+
+static void test_stringify_object() {
+    TEST_ROUNDTRIP("{}");
+    TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123.0,\"s\":\"abc\",\"a\":[1.5,2.5,3.5],\"o\":{\"1\":1.5,\"2\":2.5,\"3\":3.5}}");
+}
+
+static void test_stringify_buffer() {
+    ason_value v;
+    char* buffer = NULL;
+    size_t capacity = 0, length;
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, "[\"a long enough string to grow the buffer\", 1.5]"));
+    length = ason_stringify_buffer(&v, &buffer, &capacity);
+    EXPECT_EQ_STRING("[\"a long enough string to grow the buffer\",1.5]", buffer, length);
+    EXPECT_TRUE(capacity > length);
+    ason_set_boolean(&v, 1);
+    length = ason_stringify_buffer(&v, &buffer, &capacity);
+    EXPECT_EQ_STRING("true", buffer, length);
+    free(buffer);
+
+    /* tiny caller buffers grow too */
+    for (capacity = 1; capacity <= 4; capacity++) {
+        size_t size = capacity;
+        buffer = (char*)malloc(size);
+        length = ason_stringify_buffer(&v, &buffer, &size);
+        EXPECT_EQ_STRING("true", buffer, length);
+        EXPECT_TRUE(size > length);
+        free(buffer);
+    }
+    ason_free(&v);
+}
+
+static void test_stringify() {
+    TEST_ROUNDTRIP("null");
+    TEST_ROUNDTRIP("false");
+    TEST_ROUNDTRIP("true");
+    test_stringify_number();
+    test_stringify_integer();
+    test_stringify_string();
+    test_stringify_array();
+    test_stringify_object();
+    test_stringify_buffer();
+}
+
 static void test_access_null() {
     ason_value v;
     ason_init(&v);
@@ -371,6 +536,19 @@ static void test_access_number() {
     ason_free(&v);
 }
 
+static void test_access_integer() {
+    ason_value v;
+    ason_init(&v);
+    ason_set_string(&v, "a", 1);
+    ason_set_integer(&v, -42);
+    EXPECT_TRUE(ason_is_integer(&v));
+    EXPECT_TRUE(-42 == ason_get_integer(&v));
+    EXPECT_EQ_DOUBLE(-42.0, ason_get_number(&v));
+    ason_set_number(&v, 1.5);
+    EXPECT_FALSE(ason_is_integer(&v));
+    ason_free(&v);
+}
+
 static void test_access_string() {
     ason_value v;
     ason_init(&v);
@@ -381,11 +559,410 @@ static void test_access_string() {
     ason_free(&v);
 }
 
+static void test_access_short_string() {
+    const char* s = "0123456789\0abcdefghij";
+    ason_value v;
+    size_t len;
+    EXPECT_EQ_SIZE_T(16, sizeof(ason_value));
+    ason_init(&v);
+    /* both sides of the inline limit, '\0' included */
+    for (len = 0; len <= 21; len++) {
+        ason_set_string(&v, s, len);
+        EXPECT_EQ_SIZE_T(len, ason_get_string_length(&v));
+        EXPECT_TRUE(memcmp(s, ason_get_string(&v), len) == 0);
+        EXPECT_TRUE(ason_get_string(&v)[len] == '\0');
+    }
+    ason_free(&v);
+    TEST_STRING("0123456789abc", "\"0123456789abc\"");
+    TEST_STRING("0123456789abcd", "\"0123456789abcd\"");
+}
+
+#define TEST_ERROR_N(error, json, len) \
+    do { \
+        ason_value v; \
+        ason_init(&v); \
+        EXPECT_EQ_INT(error, ason_parse_n(&v, json, len)); \
+        EXPECT_EQ_INT(ASON_NULL, ason_get_type(&v)); \
+    } while(0)
+
+static void test_parse_n() {
+    ason_value v;
+    char padded[8 + ASON_PADDING] = "[1234567";
+
+    /* bytes after len are never looked at */
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, "[1,2]xyz", 5));
+    EXPECT_EQ_SIZE_T(2, ason_get_array_size(&v));
+    ason_free(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, "123456789", 4));
+    EXPECT_EQ_DOUBLE(1234.0, ason_get_number(&v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, "1.5e10", 5));
+    EXPECT_EQ_DOUBLE(1.5e1, ason_get_number(&v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, "\"a\\u0000b\"c", 10));
+    EXPECT_EQ_STRING("a\0b", ason_get_string(&v), ason_get_string_length(&v));
+    ason_free(&v);
+
+    TEST_ERROR_N(ASON_PARSE_EXPECT_VALUE, "  1", 2);
+    TEST_ERROR_N(ASON_PARSE_INVALID_VALUE, "true", 3);
+    TEST_ERROR_N(ASON_PARSE_INVALID_VALUE, "1.5", 2);
+    TEST_ERROR_N(ASON_PARSE_INVALID_VALUE, "1e5", 2);
+    TEST_ERROR_N(ASON_PARSE_MISS_QUOTATION_MARK, "\"abc\"", 4);
+    TEST_ERROR_N(ASON_PARSE_INVALID_STRING_CHAR, "\"a\0\"", 4);
+    TEST_ERROR_N(ASON_PARSE_INVALID_UNICODE_HEX, "\"\\u1234\"", 6);
+    TEST_ERROR_N(ASON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uDC00\"", 8);
+    TEST_ERROR_N(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1,2]", 4);
+    TEST_ERROR_N(ASON_PARSE_ROOT_NOT_SINGULAR, "1 \0", 3);
+
+    /* digits in the padding do not belong to the number */
+    memcpy(padded + 8, "89012345", ASON_PADDING);
+    TEST_ERROR_N(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, padded, 8);
+    padded[7] = ']';
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&v, padded, 8, ASON_PARSE_PADDED));
+    EXPECT_EQ_DOUBLE(123456.0, ason_get_number(ason_get_array_element(&v, 0)));
+    ason_free(&v);
+    padded[7] = '7';
+    EXPECT_EQ_INT(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ason_parse_ex(&v, padded, 8, ASON_PARSE_PADDED));
+}
+
+/* records the events as compact text, stops after the "stop" key */
+typedef struct {
+    char buf[256];
+    size_t len;
+} sax_log;
+
+static int sax_put(void* ctx, const char* s, size_t len) {
+    sax_log* log = (sax_log*)ctx;
+    memcpy(log->buf + log->len, s, len);
+    log->buf[log->len += len] = '\0';
+    return 1;
+}
+
+static int sax_null(void* ctx) { return sax_put(ctx, "n", 1); }
+static int sax_boolean(void* ctx, int b) { return sax_put(ctx, b ? "t" : "f", 1); }
+static int sax_number(void* ctx, double d) { char b[32]; return sax_put(ctx, b, (size_t)sprintf(b, "d%g", d)); }
+static int sax_integer(void* ctx, int64_t i) { char b[32]; return sax_put(ctx, b, (size_t)sprintf(b, "i%ld", (long)i)); }
+static int sax_string(void* ctx, const char* s, size_t len) { return sax_put(ctx, "s", 1) && sax_put(ctx, s, len); }
+static int sax_start_object(void* ctx) { return sax_put(ctx, "{", 1); }
+static int sax_key(void* ctx, const char* s, size_t len) {
+    return sax_put(ctx, "k", 1) && sax_put(ctx, s, len) && !(len == 4 && memcmp(s, "stop", 4) == 0);
+}
+static int sax_end_object(void* ctx, size_t count) { char b[32]; return sax_put(ctx, b, (size_t)sprintf(b, "}%d", (int)count)); }
+static int sax_start_array(void* ctx) { return sax_put(ctx, "[", 1); }
+static int sax_end_array(void* ctx, size_t count) { char b[32]; return sax_put(ctx, b, (size_t)sprintf(b, "]%d", (int)count)); }
+
+#define TEST_SAX(expect_ret, expect, json) \
+    do { \
+        log.len = 0; \
+        log.buf[0] = '\0'; \
+        EXPECT_EQ_INT(expect_ret, ason_parse_sax(&h, &log, json, strlen(json))); \
+        EXPECT_EQ_STRING(expect, log.buf, log.len); \
+    } while(0)
+
+static void test_parse_sax() {
+    ason_sax_handler h = {
+        sax_null, sax_boolean, sax_number, sax_integer, sax_string,
+        sax_start_object, sax_key, sax_end_object, sax_start_array, sax_end_array
+    };
+    sax_log log;
+
+    TEST_SAX(ASON_PARSE_OK, "n", " null ");
+    TEST_SAX(ASON_PARSE_OK, "[tfi-12d1.5]4", "[ true, false, -12, 1.5 ]");
+    TEST_SAX(ASON_PARSE_OK, "{kas\nbk[[]0{}0]2}2", "{ \"a\" : \"\\nb\", \"\" : [ [ ], { } ] }");
+    h.integer = NULL;
+    TEST_SAX(ASON_PARSE_OK, "d7", "7");
+
+    /* events before the error have been delivered */
+    TEST_SAX(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[d1", "[1 2]");
+    TEST_SAX(ASON_PARSE_EXPECT_VALUE, "{k", "{\"\":");
+    TEST_SAX(ASON_PARSE_ROOT_NOT_SINGULAR, "n", "null x");
+    TEST_SAX(ASON_PARSE_INVALID_STRING_ESCAPE, "[", "[\"\\v\"]");
+    TEST_SAX(ASON_PARSE_ABORTED, "{ka{kstop", "{\"a\":{\"stop\":1},\"b\":2}");
+}
+
+/* every split into two chunks, and one byte at a time, must agree with ason_parse */
+static void test_parser_split(ason_parser* p, const char* json) {
+    ason_value expect, v;
+    size_t len = strlen(json), i, j;
+    int expect_ret, ret;
+    char *s1, *s2;
+    ason_init(&expect);
+    expect_ret = ason_parse(&expect, json);
+    s1 = expect_ret == ASON_PARSE_OK ? ason_stringify(&expect, NULL) : NULL;
+    for (i = 0; i <= len + 1; i++) {
+        if (i <= len) {
+            ret = ason_parser_feed(p, json, i);
+            if (ret == ASON_PARSE_OK)
+                ret = ason_parser_feed(p, json + i, len - i);
+        }
+        else
+            for (j = 0, ret = ASON_PARSE_OK; j < len && ret == ASON_PARSE_OK; j++)
+                ret = ason_parser_feed(p, json + j, 1);
+        if (ret == ASON_PARSE_OK)
+            ret = ason_parser_finish(p, &v);
+        else
+            EXPECT_EQ_INT(ret, ason_parser_finish(p, &v));
+        EXPECT_EQ_INT(expect_ret, ret);
+        if (ret == ASON_PARSE_OK && expect_ret == ASON_PARSE_OK) {
+            s2 = ason_stringify(&v, NULL);
+            EXPECT_TRUE(strcmp(s1, s2) == 0);
+            free(s2);
+        }
+        ason_free(&v);
+    }
+    free(s1);
+    ason_free(&expect);
+}
+
+static void test_parser_feed() {
+    ason_parser* p = ason_parser_create();
+    ason_value v;
+    char chunk[65];
+    test_parser_split(p, "{ \"a\\u00e9\" : [ null, true, false, -12.5e+3, 18446744073709551616, \"x\\uD834\\uDD1E\\\"y\" ], \"b\" : { }, \"c\" : [ ] }");
+    test_parser_split(p, " 0.000000123456789012345 ");
+    test_parser_split(p, "[0.0000000000000000000000000000000000000000000000000000000000123]");
+    test_parser_split(p, "\"\\\\\\\"\"");
+    test_parser_split(p, "");
+    test_parser_split(p, "[1,2");
+    test_parser_split(p, "[1.2.3]");
+    test_parser_split(p, "[nul]");
+    test_parser_split(p, "{\"a\" 1}");
+    test_parser_split(p, "{\"a\":1,}");
+    test_parser_split(p, "{\"\\v\":1}");
+    test_parser_split(p, "\"\\uD800\\u12\"");
+    test_parser_split(p, "1e309");
+    test_parser_split(p, "truex");
+    test_parser_split(p, "[[[[]]], {\"k\":[{}]}] ]");
+
+    /* a long fraction cut by a chunk is decoded from the token buffer, nothing past it may be read */
+    memcpy(chunk, "[0.", 3);
+    memset(chunk + 3, '0', 58);
+    memcpy(chunk + 61, "123]", 4);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parser_feed(p, chunk, 3));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parser_feed(p, chunk + 3, 62));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parser_finish(p, &v));
+    EXPECT_EQ_DOUBLE(1.23e-59, ason_get_number(ason_get_array_element(&v, 0)));
+    ason_free(&v);
+    ason_parser_destroy(p);
+}
+
+static void test_parse_ndjson() {
+    const char* json = "{\"a\":1}\n\n  \r\n[1,2]\r\n{\"a\":}\n\"last\"";
+    ason_ndjson r;
+    char* big;
+    size_t i, len;
+
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_VALUE, ason_parse_ndjson(&r, json, strlen(json), 2));
+    EXPECT_EQ_SIZE_T(4, r.count);
+    EXPECT_EQ_INT(ASON_PARSE_OK, r.errors[0]);
+    EXPECT_EQ_INT(ASON_OBJECT, ason_get_type(&r.values[0]));
+    EXPECT_EQ_SIZE_T(4, r.lines[1]);
+    EXPECT_EQ_SIZE_T(2, ason_get_array_size(&r.values[1]));
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_VALUE, r.errors[2]);
+    EXPECT_EQ_INT(ASON_NULL, ason_get_type(&r.values[2]));
+    EXPECT_EQ_SIZE_T(6, r.lines[3]);
+    EXPECT_EQ_STRING("last", ason_get_string(&r.values[3]), ason_get_string_length(&r.values[3]));
+    ason_ndjson_free(&r);
+
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ndjson(&r, "", 0, 4));
+    EXPECT_EQ_SIZE_T(0, r.count);
+    ason_ndjson_free(&r);
+
+    /* large enough to be split between workers, order must survive */
+    big = (char*)malloc(20000 * 16);
+    for (i = 0, len = 0; i < 20000; i++)
+        len += sprintf(big + len, "[%d,\"x\"]\n", (int)i);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ndjson(&r, big, len, 4));
+    EXPECT_EQ_SIZE_T(20000, r.count);
+    for (i = 0; i < r.count; i++)
+        if (ason_get_number(ason_get_array_element(&r.values[i], 0)) != (double)i || r.lines[i] != i + 1)
+            break;
+    EXPECT_EQ_SIZE_T(20000, i);
+    ason_ndjson_free(&r);
+    free(big);
+}
+
+static void test_parse_intern_keys() {
+    const char* json = "[ { \"id\" : 1, \"name\" : \"a\" }, { \"name\" : \"b\", \"id\" : 2 }, { \"i\\u0064\" : 3, \"x\" : {} } ]";
+    ason_document* doc = ason_document_create();
+    ason_value v, w;
+    char big[2048];
+    size_t i, len;
+
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&v, json, strlen(json), ASON_PARSE_INTERN_KEYS));
+    EXPECT_TRUE(ason_get_object_key(ason_get_array_element(&v, 0), 0) == ason_get_object_key(ason_get_array_element(&v, 1), 1));
+    EXPECT_TRUE(ason_get_object_key(ason_get_array_element(&v, 0), 0) == ason_get_object_key(ason_get_array_element(&v, 2), 0));
+    EXPECT_EQ_STRING("name", ason_get_object_key(ason_get_array_element(&v, 1), 0), ason_get_object_key_length(ason_get_array_element(&v, 1), 0));
+    EXPECT_EQ_DOUBLE(2.0, ason_get_number(ason_find_object_value(ason_get_array_element(&v, 1), "id", 2)));
+    /* keys outlive the values they were parsed with */
+    memcpy(&w, ason_get_array_element(&v, 2), sizeof(ason_value));
+    ason_init(ason_get_array_element(&v, 2));
+    ason_free(&v);
+    EXPECT_EQ_STRING("id", ason_get_object_key(&w, 0), ason_get_object_key_length(&w, 0));
+    ason_free(&w);
+
+    EXPECT_EQ_INT(ASON_PARSE_MISS_COLON, ason_parse_ex(&v, "[{\"a\":1},{\"a\":2,\"b\"}]", 20, ASON_PARSE_INTERN_KEYS));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse_ex(doc, json, strlen(json), ASON_PARSE_INTERN_KEYS));
+    EXPECT_TRUE(ason_get_object_key(ason_get_array_element(ason_document_root(doc), 0), 1) ==
+        ason_get_object_key(ason_get_array_element(ason_document_root(doc), 1), 0));
+    ason_document_free(doc);
+
+    /* enough keys to grow the table and to index the object */
+    len = sprintf(big, "{");
+    for (i = 0; i < 100; i++)
+        len += sprintf(big + len, "\"k%d\":{\"k%d\":0},", (int)i, (int)i);
+    big[len - 1] = '}';
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&v, big, len, ASON_PARSE_INTERN_KEYS));
+    EXPECT_EQ_SIZE_T(57, ason_find_object_index(&v, "k57", 3));
+    EXPECT_TRUE(ason_get_object_key(&v, 9) == ason_get_object_key(ason_get_object_value(&v, 9), 0));
+    ason_free(&v);
+}
+
+/* n levels, arrays and objects in turn, around a 1 */
+static char* test_nested(size_t n) {
+    char* json = (char*)malloc(n * 6 + 2);
+    size_t i, len = 0;
+    for (i = 0; i < n; i++)
+        len += sprintf(json + len, i % 2 ? "{\"k\":" : "[");
+    json[len++] = '1';
+    for (i = n; i-- > 0; )
+        json[len++] = i % 2 ? '}' : ']';
+    json[len] = '\0';
+    return json;
+}
+
+static void test_parse_depth_exceeded() {
+    ason_sax_handler h = { 0 };
+    ason_document* doc = ason_document_create();
+    ason_parser* p = ason_parser_create();
+    ason_value v, *a;
+    char *json, *s;
+    size_t i;
+
+    /* ASON_PARSE_MAX_DEPTH levels parse, one more does not */
+    for (i = 0; i < 2; i++) {
+        json = test_nested(1024 + i);
+        ason_init(&v);
+        EXPECT_EQ_INT(i ? ASON_PARSE_DEPTH_EXCEEDED : ASON_PARSE_OK, ason_parse(&v, json));
+        EXPECT_EQ_INT(i ? ASON_NULL : ASON_ARRAY, ason_get_type(&v));
+        if (!i) {
+            s = ason_stringify(&v, NULL);
+            EXPECT_TRUE(strcmp(json, s) == 0);
+            free(s);
+        }
+        ason_free(&v);
+        EXPECT_EQ_INT(i ? ASON_PARSE_DEPTH_EXCEEDED : ASON_PARSE_OK, ason_parse_sax(&h, NULL, json, strlen(json)));
+        EXPECT_EQ_INT(i ? ASON_PARSE_DEPTH_EXCEEDED : ASON_PARSE_OK, ason_document_parse(doc, json));
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parser_feed(p, json, 1024));
+        EXPECT_EQ_INT(i ? ASON_PARSE_DEPTH_EXCEEDED : ASON_PARSE_OK, ason_parser_feed(p, json + 1024, strlen(json) - 1024));
+        ason_parser_finish(p, &v);
+        ason_free(&v);
+        free(json);
+    }
+
+    /* hostile input fails without touching the C stack */
+    json = (char*)malloc(100001);
+    memset(json, '[', 100000);
+    json[100000] = '\0';
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_DEPTH_EXCEEDED, ason_parse(&v, json));
+    EXPECT_EQ_INT(ASON_PARSE_DEPTH_EXCEEDED, ason_parse_sax(&h, NULL, json, strlen(json)));
+    free(json);
+
+    /* errors deep inside free everything parsed so far */
+    json = test_nested(200);
+    *strchr(json, '1') = 'x';
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_VALUE, ason_parse(&v, json));
+    *strchr(json, 'x') = '1';
+    json[strlen(json) - 1] = '\0';
+    EXPECT_EQ_INT(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ason_parse(&v, json));
+    free(json);
+
+    /* values built by hand can be deeper still, ason_free does not recurse either */
+    ason_set_array(&v, 0);
+    for (i = 0, a = &v; i < 100000; i++)
+        ason_set_array(a = ason_pushback_array_element(a), 1);
+    ason_free(&v);
+
+    ason_document_free(doc);
+    ason_parser_destroy(p);
+}
+
+/* every length from every alignment, so the vector kernels meet each lane and the end of each block */
+static void test_parse_scan() {
+    char* raw = (char*)malloc(256 + 32), *base = raw + ((32 - ((uintptr_t)raw & 31)) & 31), *p, *json;
+    ason_value v;
+    size_t off, n, len;
+
+    ason_init(&v);
+    for (off = 0; off < 32; off++) {
+        for (n = 0; n < 70; n++) {
+            p = base + off;
+            p[0] = '"';
+            memset(p + 1, 'a', n);
+            p[n + 1] = '"';
+            EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, p, n + 2));
+            EXPECT_EQ_SIZE_T(n, ason_get_string_length(&v));
+            ason_free(&v);
+            EXPECT_EQ_INT(ASON_PARSE_OK, ason_validate(p, n + 2));
+            EXPECT_EQ_INT(ASON_PARSE_MISS_QUOTATION_MARK, ason_parse_n(&v, p, n + 1));
+            if (n > 0) {
+                p[n] = '\x1F';
+                EXPECT_EQ_INT(ASON_PARSE_INVALID_STRING_CHAR, ason_parse_n(&v, p, n + 2));
+                p[n] = '"';
+                EXPECT_EQ_INT(ASON_PARSE_ROOT_NOT_SINGULAR, ason_parse_n(&v, p, n + 2));
+                p[n] = '\\';
+                p[n + 1] = 'n';
+                p[n + 2] = '"';
+                EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, p, n + 3));
+                EXPECT_EQ_SIZE_T(n, ason_get_string_length(&v));
+                EXPECT_TRUE(ason_get_string(&v)[n - 1] == '\n');
+                ason_free(&v);
+                p[n] = '\xC3';
+                p[n + 1] = '"';
+                EXPECT_EQ_INT(ASON_PARSE_INVALID_UTF8, ason_validate(p, n + 2));
+                p[n + 1] = '\xA9';
+                p[n + 2] = '"';
+                EXPECT_EQ_INT(ASON_PARSE_OK, ason_validate(p, n + 3));
+            }
+
+            memset(p, ' ', n);
+            p[n] = '1';
+            memset(p + n + 1, '\n', n);
+            EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, p, 2 * n + 1));
+            EXPECT_EQ_DOUBLE(1.0, ason_get_number(&v));
+            EXPECT_EQ_INT(ASON_PARSE_EXPECT_VALUE, ason_parse_n(&v, p, n));
+            p[2 * n + 1] = 'x';
+            EXPECT_EQ_INT(ASON_PARSE_ROOT_NOT_SINGULAR, ason_parse_n(&v, p, 2 * n + 2));
+        }
+    }
+
+    /* stringify copies plain runs and escapes what stops them */
+    for (n = 1; n < 70; n++) {
+        memset(base, 'b', n);
+        base[n - 1] = '\x01';
+        ason_set_string(&v, base, n);
+        json = ason_stringify(&v, &len);
+        EXPECT_EQ_SIZE_T(n + 7, len);
+        EXPECT_TRUE(memcmp(json + n, "\\u0001\"", 7) == 0);
+        free(json);
+        base[n - 1] = '"';
+        ason_set_string(&v, base, n);
+        json = ason_stringify(&v, &len);
+        EXPECT_EQ_SIZE_T(n + 3, len);
+        EXPECT_TRUE(memcmp(json + n, "\\\"\"", 3) == 0);
+        free(json);
+    }
+    ason_free(&v);
+    free(raw);
+}
+
 static void test_parse() {
     test_parse_null();
     test_parse_false();
     test_parse_true();
     test_parse_number();
+    test_parse_integer();
     test_parse_string();
     test_parse_array();
     test_parse_object();
@@ -403,18 +980,1104 @@ static void test_parse() {
     test_parse_miss_key();
     test_parse_miss_colon();
     test_parse_miss_comma_or_curly_bracket();
+    test_parse_depth_exceeded();
+
+    test_parse_n();
+    test_parse_sax();
+    test_parser_feed();
+    test_parse_ndjson();
+    test_parse_intern_keys();
+    test_parse_scan();
+}
+
+static void test_document() {
+    ason_document* doc = ason_document_create();
+    ason_value* root;
+    ason_value* a;
+    size_t i;
+    char big[10000];
+
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse(doc,
+        "{ \"s\" : \"abc\", \"a\" : [ 1, \"x\\ny\", { \"k\" : null } ], \"o\" : { } }"));
+    root = ason_document_root(doc);
+    EXPECT_EQ_INT(ASON_OBJECT, ason_get_type(root));
+    EXPECT_EQ_SIZE_T(3, ason_get_object_entry_size(root));
+    EXPECT_EQ_STRING("s", ason_get_object_key(root, 0), ason_get_object_key_length(root, 0));
+    EXPECT_EQ_STRING("abc", ason_get_string(ason_get_object_value(root, 0)), ason_get_string_length(ason_get_object_value(root, 0)));
+    a = ason_get_object_value(root, 1);
+    EXPECT_EQ_SIZE_T(3, ason_get_array_size(a));
+    EXPECT_EQ_STRING("x\ny", ason_get_string(ason_get_array_element(a, 1)), ason_get_string_length(ason_get_array_element(a, 1)));
+    EXPECT_EQ_STRING("k", ason_get_object_key(ason_get_array_element(a, 2), 0), 1);
+
+    /* setters allocate from the arena, ason_free on document values releases nothing */
+    ason_document_set_string(doc, ason_get_array_element(a, 0), "hello", 5);
+    EXPECT_EQ_STRING("hello", ason_get_string(ason_get_array_element(a, 0)), ason_get_string_length(ason_get_array_element(a, 0)));
+    ason_set_number(ason_get_object_value(root, 0), 1.5);
+    ason_free(a);
+    EXPECT_EQ_INT(ASON_NULL, ason_get_type(a));
+
+    /* reparse reuses the arena, large strings get their own chunk */
+    for (i = 0; i < sizeof(big) - 3; i++)
+        big[i + 1] = 'a' + i % 26;
+    big[0] = '"';
+    big[sizeof(big) - 2] = '"';
+    big[sizeof(big) - 1] = '\0';
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse(doc, "[\"a\", \"b\"]"));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse(doc, big));
+    EXPECT_EQ_SIZE_T(sizeof(big) - 3, ason_get_string_length(ason_document_root(doc)));
+
+    EXPECT_EQ_INT(ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, ason_document_parse(doc, "{\"a\":[\"b\"],\"c\":1"));
+    EXPECT_EQ_INT(ASON_NULL, ason_get_type(ason_document_root(doc)));
+    ason_document_free(doc);
+}
+
+static void test_parse_insitu() {
+    ason_value v;
+    char json[] = "{ \"k\\tey\" : [ \"abc\", \"\\u0024\\u00A2\\u20AC\\uD834\\uDD1E x\", \"\" ], \"n\" : 1 }";
+    char bad[] = "[\"a\\u0\"]";
+    const char* s;
+
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_insitu(&v, json, sizeof(json) - 1));
+    EXPECT_EQ_STRING("k\tey", ason_get_object_key(&v, 0), ason_get_object_key_length(&v, 0));
+    EXPECT_TRUE(ason_get_object_key(&v, 0) > json && ason_get_object_key(&v, 0) < json + sizeof(json));
+    s = ason_get_string(ason_get_array_element(ason_get_object_value(&v, 0), 0));
+    EXPECT_EQ_STRING("abc", s, 3);
+    EXPECT_TRUE(s > json && s < json + sizeof(json));
+    s = ason_get_string(ason_get_array_element(ason_get_object_value(&v, 0), 1));
+    EXPECT_EQ_STRING("\x24\xC2\xA2\xE2\x82\xAC\xF0\x9D\x84\x9E x", s,
+        ason_get_string_length(ason_get_array_element(ason_get_object_value(&v, 0), 1)));
+    EXPECT_EQ_SIZE_T(0, ason_get_string_length(ason_get_array_element(ason_get_object_value(&v, 0), 2)));
+    EXPECT_EQ_DOUBLE(1.0, ason_get_number(ason_get_object_value(&v, 1)));
+    ason_free(&v);
+
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_UNICODE_HEX, ason_parse_insitu(&v, bad, sizeof(bad) - 1));
+    EXPECT_EQ_INT(ASON_NULL, ason_get_type(&v));
+}
+
+static void test_ondemand() {
+    ason_ondemand_doc* d = ason_ondemand_create();
+    ason_ondemand_value root, v, e, f;
+    ason_ondemand_iter it;
+    ason_value full;
+    const char *s, *t;
+    size_t len, tlen, i;
+    double n;
+    char json[256];
+
+    /* escapes and quotes straddle the 64-byte block boundaries */
+    sprintf(json, "{ \"pad\" : \"%s\\\\\", \"q\\\"\" : \"a,b\", \"arr\" : [ 1.5, -2, \"x\\u0041\", [ {} ], true ], \"obj\" : { \"k\" : null } }",
+        "0123456789012345678901234567890123456789012345");
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_parse(d, json, strlen(json)));
+    ason_ondemand_root(d, &root);
+    EXPECT_EQ_INT(ASON_OBJECT, ason_ondemand_get_type(&root));
+
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_find_field(&root, "q\"", 2, &v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_string(&v, &s, &len));
+    EXPECT_EQ_STRING("a,b", s, len);
+    EXPECT_EQ_INT(ASON_PARSE_NOT_FOUND, ason_ondemand_find_field(&root, "k", 1, &v));
+    EXPECT_EQ_INT(ASON_PARSE_INCORRECT_TYPE, ason_ondemand_get_double(&root, &n));
+
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_find_field(&root, "arr", 3, &v));
+    EXPECT_EQ_INT(ASON_ARRAY, ason_ondemand_get_type(&v));
+    EXPECT_EQ_INT(ASON_PARSE_INCORRECT_TYPE, ason_ondemand_find_field(&v, "k", 1, &e));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_array_iter(&v, &it));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_next(&it, &e));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_double(&e, &n));
+    EXPECT_EQ_DOUBLE(1.5, n);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_next(&it, &e));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_double(&e, &n));
+    EXPECT_EQ_DOUBLE(-2.0, n);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_next(&it, &e));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_string(&e, &s, &len));
+    EXPECT_EQ_STRING("xA", s, len);
+    /* escaped keys, strings and values read later leave it alone */
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_find_field(&root, "q\"", 2, &f));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_find_field(&root, "pad", 3, &f));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_string(&f, &t, &tlen));
+    EXPECT_EQ_SIZE_T(47, tlen);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_value(&root, &full));
+    ason_free(&full);
+    EXPECT_EQ_STRING("xA", s, len);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_next(&it, &e));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_value(&e, &full));
+    EXPECT_EQ_SIZE_T(1, ason_get_array_size(&full));
+    EXPECT_EQ_INT(ASON_OBJECT, ason_get_type(ason_get_array_element(&full, 0)));
+    ason_free(&full);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_next(&it, &e));
+    EXPECT_EQ_INT(ASON_TRUE, ason_ondemand_get_type(&e));
+    EXPECT_EQ_INT(ASON_PARSE_NOT_FOUND, ason_ondemand_next(&it, &e));
+
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_find_field(&root, "obj", 3, &v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_find_field(&v, "k", 1, &e));
+    EXPECT_EQ_INT(ASON_NULL, ason_ondemand_get_type(&e));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_get_value(&root, &full));
+    EXPECT_EQ_SIZE_T(4, ason_get_object_entry_size(&full));
+    ason_free(&full);
+
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_parse(d, "[]", 2));
+    ason_ondemand_root(d, &root);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_array_iter(&root, &it));
+    EXPECT_EQ_INT(ASON_PARSE_NOT_FOUND, ason_ondemand_next(&it, &e));
+
+    /* long inputs grow the index */
+    for (i = 0, len = 1; i < 60; i++)
+        len += sprintf(json + len, "%d,", (int)i);
+    json[0] = '[';
+    json[len - 1] = ']';
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_parse(d, json, len));
+    ason_ondemand_root(d, &root);
+    ason_ondemand_array_iter(&root, &it);
+    for (i = 0; ason_ondemand_next(&it, &e) == ASON_PARSE_OK; i++)
+        ;
+    EXPECT_EQ_SIZE_T(60, i);
+
+    EXPECT_EQ_INT(ASON_PARSE_EXPECT_VALUE, ason_ondemand_parse(d, " ", 1));
+    EXPECT_EQ_INT(ASON_PARSE_MISS_QUOTATION_MARK, ason_ondemand_parse(d, "[\"a]", 4));
+    EXPECT_EQ_INT(ASON_PARSE_ROOT_NOT_SINGULAR, ason_ondemand_parse(d, "1 2", 3));
+    EXPECT_EQ_INT(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ason_ondemand_parse(d, "[1,[2]", 6));
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_VALUE, ason_ondemand_parse(d, "}", 1));
+
+    /* validation is lazy, errors surface when the bad part is read */
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_parse(d, "[1,tru,3]", 9));
+    ason_ondemand_root(d, &root);
+    ason_ondemand_array_iter(&root, &it);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_next(&it, &e));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_next(&it, &e));
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_VALUE, ason_ondemand_get_value(&e, &full));
+    EXPECT_EQ_INT(ASON_NULL, ason_get_type(&full));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_ondemand_parse(d, "{\"a\":1 2}", 9));
+    ason_ondemand_root(d, &root);
+    EXPECT_EQ_INT(ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, ason_ondemand_find_field(&root, "b", 1, &v));
+    ason_ondemand_free(d);
+}
+
+static void test_access_object() {
+    ason_document* doc = ason_document_create();
+    ason_value v;
+    char json[4096];
+    char key[16];
+    size_t i, len;
+
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, "{\"a\":1,\"b\":2,\"a\":3,\"\":4}"));
+    EXPECT_EQ_SIZE_T(0, ason_find_object_index(&v, "a", 1));
+    EXPECT_EQ_DOUBLE(2.0, ason_get_number(ason_find_object_value(&v, "b", 1)));
+    EXPECT_EQ_DOUBLE(4.0, ason_get_number(ason_find_object_value(&v, "", 0)));
+    EXPECT_EQ_SIZE_T(ASON_KEY_NOT_EXIST, ason_find_object_index(&v, "ab", 2));
+    EXPECT_TRUE(ason_find_object_value(&v, "c", 1) == NULL);
+    ason_free(&v);
+
+    /* large enough for the hash index, duplicates still resolve to the first entry */
+    len = sprintf(json, "{");
+    for (i = 0; i < 200; i++)
+        len += sprintf(json + len, "\"k%d\":%d,", (int)i, (int)i);
+    sprintf(json + len, "\"k7\":-1}");
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, json));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse(doc, json));
+    for (i = 0; i < 200; i++) {
+        sprintf(key, "k%d", (int)i);
+        EXPECT_EQ_SIZE_T(i, ason_find_object_index(&v, key, strlen(key)));
+        EXPECT_EQ_SIZE_T(i, ason_find_object_index(ason_document_root(doc), key, strlen(key)));
+    }
+    EXPECT_EQ_SIZE_T(ASON_KEY_NOT_EXIST, ason_find_object_index(&v, "k200", 4));
+    EXPECT_EQ_SIZE_T(ASON_KEY_NOT_EXIST, ason_find_object_index(ason_document_root(doc), "k", 1));
+    EXPECT_EQ_DOUBLE(199.0, ason_get_number(ason_find_object_value(&v, "k199", 4)));
+    ason_free(&v);
+    ason_document_free(doc);
+}
+
+#define TEST_PATH(expect, json, pointer)\
+    do {\
+        ason_path* path;\
+        ason_value v, t;\
+        size_t len1, len2;\
+        char *s1, *s2;\
+        ason_init(&v);\
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, json));\
+        EXPECT_TRUE((path = ason_path_compile(pointer)) != NULL);\
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_path_eval_text(path, json, strlen(json), &t));\
+        s1 = ason_stringify(ason_path_eval(path, &v), &len1);\
+        s2 = ason_stringify(&t, &len2);\
+        EXPECT_EQ_STRING(expect, s1, len1);\
+        EXPECT_EQ_STRING(expect, s2, len2);\
+        free(s1);\
+        free(s2);\
+        ason_free(&t);\
+        ason_free(&v);\
+        ason_path_free(path);\
+    } while(0)
+
+#define TEST_PATH_ERROR(error, json, pointer)\
+    do {\
+        ason_path* path;\
+        ason_value v;\
+        EXPECT_TRUE((path = ason_path_compile(pointer)) != NULL);\
+        EXPECT_EQ_INT(error, ason_path_eval_text(path, json, strlen(json), &v));\
+        EXPECT_EQ_INT(ASON_NULL, ason_get_type(&v));\
+        if (error == ASON_PARSE_NOT_FOUND) {\
+            EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v, json));\
+            EXPECT_TRUE(ason_path_eval(path, &v) == NULL);\
+            ason_free(&v);\
+        }\
+        ason_path_free(path);\
+    } while(0)
+
+static void test_path() {
+    ason_path* path;
+    ason_value v;
+    const char* json = "{ \"a\" : { \"b\" : [ 0, \"}\\\"]\", [ { } ], { \"c\" : true, \"\" : 1 } ] },"
+        " \"m~n\" : 2, \"x/y\" : [ 3 ], \"a\" : null }";
+    TEST_PATH("{\"c\":true,\"\":1}", json, "/a/b/3");
+    TEST_PATH("true", json, "/a/b/3/c");
+    TEST_PATH("1", json, "/a/b/3/");
+    TEST_PATH("\"}\\\"]\"", json, "/a/b/1");
+    TEST_PATH("2", json, "/m~0n");
+    TEST_PATH("3", json, "/x~1y/0");
+    TEST_PATH("[1,2]", "[1,2]", "");
+    TEST_PATH("2", " { \"\\u0061\" : 2 } ", "/a");
+
+    TEST_PATH_ERROR(ASON_PARSE_NOT_FOUND, json, "/b");
+    TEST_PATH_ERROR(ASON_PARSE_NOT_FOUND, json, "/a/b/4");
+    TEST_PATH_ERROR(ASON_PARSE_NOT_FOUND, json, "/a/b/01");
+    TEST_PATH_ERROR(ASON_PARSE_NOT_FOUND, json, "/a/b/-");
+    TEST_PATH_ERROR(ASON_PARSE_NOT_FOUND, json, "/a/b/0/c");
+    TEST_PATH_ERROR(ASON_PARSE_NOT_FOUND, json, "/a/b/2/0/c");
+    TEST_PATH_ERROR(ASON_PARSE_NOT_FOUND, "[]", "/0");
+    TEST_PATH_ERROR(ASON_PARSE_EXPECT_VALUE, "", "");
+    TEST_PATH_ERROR(ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1 \"b\":2}", "/b");
+    TEST_PATH_ERROR(ASON_PARSE_MISS_QUOTATION_MARK, "[\"a, 1]", "/1");
+    TEST_PATH_ERROR(ASON_PARSE_INVALID_VALUE, "{\"a\":[1,[2]", "/b");
+
+    /* what lies beyond the target is not looked at */
+    path = ason_path_compile("/a");
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_path_eval_text(path, "{\"a\":1,\"b\":?}", 13, &v));
+    EXPECT_EQ_DOUBLE(1.0, ason_get_number(&v));
+    ason_path_free(path);
+
+    EXPECT_TRUE(ason_path_compile("a") == NULL);
+    EXPECT_TRUE(ason_path_compile("/a~2") == NULL);
+    EXPECT_TRUE(ason_path_compile("/a~") == NULL);
+}
+
+static void test_binary() {
+    const char* json = "{\"s\":\"a\\u0000b\",\"n\":[null,false,true,1.5,-9007199254740993,{}],\"b\":{\"y\":1,\"x\":2,\"y\":3,\"\":[]}}";
+    ason_binary_view root, v, e;
+    ason_value a, b;
+    char *bin, *s1, *s2;
+    const char* s;
+    size_t len, len1, len2;
+
+    ason_init(&a);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&a, json));
+    EXPECT_TRUE((bin = ason_encode_binary(&a, &len)) != NULL);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_binary_open(&root, bin, len));
+    EXPECT_EQ_INT(ASON_OBJECT, ason_binary_get_type(&root));
+    EXPECT_EQ_SIZE_T(3, ason_binary_get_size(&root));
+    s = ason_binary_get_key(&root, 1, &len1);
+    EXPECT_EQ_STRING("n", s, len1);
+
+    ason_binary_get_value(&root, 0, &v);
+    s = ason_binary_get_string(&v, &len1);
+    EXPECT_EQ_STRING("a\0b", s, len1);
+    EXPECT_TRUE(s[len1] == '\0');
+
+    ason_binary_get_value(&root, ason_binary_find_key(&root, "n", 1), &v);
+    EXPECT_EQ_SIZE_T(6, ason_binary_get_size(&v));
+    ason_binary_get_element(&v, 2, &e);
+    EXPECT_EQ_INT(ASON_TRUE, ason_binary_get_type(&e));
+    ason_binary_get_element(&v, 3, &e);
+    EXPECT_FALSE(ason_binary_is_integer(&e));
+    EXPECT_EQ_DOUBLE(1.5, ason_binary_get_number(&e));
+    ason_binary_get_element(&v, 4, &e);
+    EXPECT_TRUE(ason_binary_is_integer(&e));
+    EXPECT_TRUE(ason_binary_get_integer(&e) == -(int64_t)9007199254740992.0 - 1);
+    ason_binary_get_element(&v, 5, &e);
+    EXPECT_EQ_SIZE_T(ASON_KEY_NOT_EXIST, ason_binary_find_key(&e, "a", 1));
+
+    /* keys are searched in sorted order, duplicates give the first */
+    ason_binary_get_value(&root, 2, &v);
+    EXPECT_EQ_SIZE_T(0, ason_binary_find_key(&v, "y", 1));
+    EXPECT_EQ_SIZE_T(1, ason_binary_find_key(&v, "x", 1));
+    EXPECT_EQ_SIZE_T(3, ason_binary_find_key(&v, "", 0));
+    EXPECT_EQ_SIZE_T(ASON_KEY_NOT_EXIST, ason_binary_find_key(&v, "xx", 2));
+    EXPECT_EQ_SIZE_T(ASON_KEY_NOT_EXIST, ason_binary_find_key(&v, "z", 1));
+
+    /* back to a value without loss, key order included */
+    ason_binary_to_value(&root, &b);
+    s1 = ason_stringify(&a, &len1);
+    s2 = ason_stringify(&b, &len2);
+    EXPECT_EQ_SIZE_T(len1, len2);
+    EXPECT_TRUE(memcmp(s1, s2, len1) == 0);
+    EXPECT_TRUE(ason_is_integer(ason_get_array_element(ason_get_object_value(&b, 1), 4)));
+    free(s1);
+    free(s2);
+    ason_free(&b);
+
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_VALUE, ason_binary_open(&root, bin, len - 1));
+    EXPECT_EQ_INT(ASON_PARSE_INVALID_VALUE, ason_binary_open(&root, json, strlen(json)));
+    free(bin);
+    ason_free(&a);
+}
+
+static void test_access_array() {
+    ason_value a, e;
+    size_t i, j;
+
+    ason_init(&a);
+    for (j = 0; j <= 5; j += 5) {
+        ason_set_array(&a, j);
+        EXPECT_EQ_SIZE_T(0, ason_get_array_size(&a));
+        EXPECT_EQ_SIZE_T(j, ason_get_array_capacity(&a));
+        for (i = 0; i < 10; i++) {
+            ason_init(&e);
+            ason_set_number(&e, i);
+            ason_move(ason_pushback_array_element(&a), &e);
+            ason_free(&e);
+        }
+        EXPECT_EQ_SIZE_T(10, ason_get_array_size(&a));
+        for (i = 0; i < 10; i++)
+            EXPECT_EQ_DOUBLE((double)i, ason_get_number(ason_get_array_element(&a, i)));
+    }
+
+    ason_popback_array_element(&a);
+    EXPECT_EQ_SIZE_T(9, ason_get_array_size(&a));
+    ason_erase_array_element(&a, 4, 0);
+    EXPECT_EQ_SIZE_T(9, ason_get_array_size(&a));
+    ason_erase_array_element(&a, 8, 1);
+    ason_erase_array_element(&a, 0, 2);
+    EXPECT_EQ_SIZE_T(6, ason_get_array_size(&a));
+    for (i = 0; i < 6; i++)
+        EXPECT_EQ_DOUBLE((double)i + 2, ason_get_number(ason_get_array_element(&a, i)));
+
+    for (i = 0; i < 2; i++)
+        ason_set_number(ason_insert_array_element(&a, i), i);
+    EXPECT_EQ_SIZE_T(8, ason_get_array_size(&a));
+    for (i = 0; i < 8; i++)
+        EXPECT_EQ_DOUBLE((double)i, ason_get_number(ason_get_array_element(&a, i)));
+
+    EXPECT_TRUE(ason_get_array_capacity(&a) > 8);
+    ason_shrink_array(&a);
+    EXPECT_EQ_SIZE_T(8, ason_get_array_capacity(&a));
+    ason_set_string(ason_pushback_array_element(&a), "a long enough string", 20);
+    ason_clear_array(&a);
+    EXPECT_EQ_SIZE_T(0, ason_get_array_size(&a));
+    ason_shrink_array(&a);
+    EXPECT_EQ_SIZE_T(0, ason_get_array_capacity(&a));
+    ason_free(&a);
+}
+
+static void test_access_object_mutation() {
+    ason_value o, v;
+    char key[16];
+    size_t i, j, index;
+    const char* json = "{\"k\":1,\"z\":[1,2]}";
+
+    ason_init(&o);
+    for (j = 0; j <= 5; j += 5) {
+        ason_set_object(&o, j);
+        EXPECT_EQ_SIZE_T(0, ason_get_object_entry_size(&o));
+        EXPECT_EQ_SIZE_T(j, ason_get_object_capacity(&o));
+        /* past the hash index threshold, the index follows appends */
+        for (i = 0; i < 40; i++) {
+            key[0] = 'a' + i % 26;
+            key[1] = '0' + (char)(i / 26);
+            ason_set_number(ason_set_object_value(&o, key, 2), i);
+            EXPECT_EQ_SIZE_T(i, ason_find_object_index(&o, key, 2));
+        }
+        EXPECT_EQ_SIZE_T(40, ason_get_object_entry_size(&o));
+        for (i = 0; i < 40; i++) {
+            key[0] = 'a' + i % 26;
+            key[1] = '0' + (char)(i / 26);
+            EXPECT_EQ_DOUBLE((double)i, ason_get_number(ason_find_object_value(&o, key, 2)));
+        }
+    }
+
+    /* existing keys are found, not added */
+    EXPECT_EQ_DOUBLE(3.0, ason_get_number(ason_set_object_value(&o, "d0", 2)));
+    EXPECT_EQ_SIZE_T(40, ason_get_object_entry_size(&o));
+    index = ason_find_object_index(&o, "j0", 2);
+    ason_remove_object_value(&o, index);
+    EXPECT_EQ_SIZE_T(ASON_KEY_NOT_EXIST, ason_find_object_index(&o, "j0", 2));
+    EXPECT_EQ_SIZE_T(39, ason_get_object_entry_size(&o));
+    EXPECT_EQ_SIZE_T(9, ason_find_object_index(&o, "k0", 2));
+
+    ason_shrink_object(&o);
+    EXPECT_EQ_SIZE_T(39, ason_get_object_capacity(&o));
+    ason_clear_object(&o);
+    EXPECT_EQ_SIZE_T(0, ason_get_object_entry_size(&o));
+    ason_shrink_object(&o);
+    EXPECT_EQ_SIZE_T(0, ason_get_object_capacity(&o));
+
+    /* borrowed and interned keys become owned once a key is added */
+    ason_free(&o);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&o, json, strlen(json), ASON_PARSE_INTERN_KEYS));
+    ason_set_boolean(ason_set_object_value(&o, "t", 1), 1);
+    ason_init(&v);
+    ason_swap(&v, ason_find_object_value(&o, "z", 1));
+    EXPECT_EQ_INT(ASON_NULL, ason_get_type(ason_get_object_value(&o, 1)));
+    EXPECT_EQ_SIZE_T(2, ason_get_array_size(&v));
+    ason_free(&o);
+    ason_free(&v);
 }
 
 static void test_access() {
     test_access_null();
     test_access_boolean();
     test_access_number();
+    test_access_integer();
     test_access_string();
+    test_access_short_string();
+    test_access_object();
+    test_access_array();
+    test_access_object_mutation();
+}
+
+static void test_copy() {
+    ason_document* doc = ason_document_create();
+    ason_value a, b;
+    const char* json = "{\"t\":true,\"f\":false,\"n\":null,\"d\":1.5,\"i\":-7,\"s\":\"a longer string, not inline\","
+        "\"a\":[1,2,3,\"abc\",[],{}],\"o\":{\"1\":1,\"2\":2,\"3\":3}}";
+    unsigned flags[2] = { 0, ASON_PARSE_INTERN_KEYS };
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        ason_init(&a);
+        ason_init(&b);
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&a, json, strlen(json), flags[i]));
+        ason_copy(&b, &a);
+        EXPECT_TRUE(ason_is_equal(&a, &b));
+        EXPECT_EQ_SIZE_T(8, ason_get_object_capacity(&b));
+        /* the copy is independent of its source */
+        ason_free(&a);
+        EXPECT_EQ_STRING("abc", ason_get_string(ason_get_array_element(ason_find_object_value(&b, "a", 1), 3)), 3);
+        ason_set_boolean(ason_set_object_value(&b, "x", 1), 1);
+        ason_free(&b);
+    }
+
+    /* arena values copy to owned ones */
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse(doc, json));
+    ason_init(&b);
+    ason_copy(&b, ason_document_root(doc));
+    ason_document_free(doc);
+    ason_pushback_array_element(ason_find_object_value(&b, "a", 1));
+    EXPECT_EQ_SIZE_T(7, ason_get_array_size(ason_find_object_value(&b, "a", 1)));
+    ason_free(&b);
+}
+
+#define TEST_EQUAL(json1, json2, equality) \
+    do {\
+        ason_value v1, v2;\
+        ason_init(&v1);\
+        ason_init(&v2);\
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v1, json1));\
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&v2, json2));\
+        EXPECT_EQ_INT(equality, ason_is_equal(&v1, &v2));\
+        if (equality)\
+            EXPECT_TRUE(ason_hash(&v1) == ason_hash(&v2));\
+        else\
+            EXPECT_TRUE(ason_hash(&v1) != ason_hash(&v2));\
+        ason_free(&v1);\
+        ason_free(&v2);\
+    } while(0)
+
+static void test_equal() {
+    ason_value o1, o2;
+    char key[8], json[512], *big;
+    int i, n;
+
+    TEST_EQUAL("true", "true", 1);
+    TEST_EQUAL("true", "false", 0);
+    TEST_EQUAL("false", "false", 1);
+    TEST_EQUAL("null", "null", 1);
+    TEST_EQUAL("null", "0", 0);
+    TEST_EQUAL("123", "123", 1);
+    TEST_EQUAL("123", "456", 0);
+    TEST_EQUAL("1", "1.0", 1);
+    TEST_EQUAL("0", "-0.0", 1);
+    TEST_EQUAL("9007199254740992", "9007199254740992.0", 1);
+    TEST_EQUAL("-9223372036854775808", "-9223372036854775808.0", 1);
+    TEST_EQUAL("\"abc\"", "\"abc\"", 1);
+    TEST_EQUAL("\"abc\"", "\"abcd\"", 0);
+    TEST_EQUAL("[]", "[]", 1);
+    TEST_EQUAL("[]", "null", 0);
+    TEST_EQUAL("[1,2,3]", "[1,2,3]", 1);
+    TEST_EQUAL("[1,2,3]", "[1,2,3,4]", 0);
+    TEST_EQUAL("[1,2,3]", "[3,2,1]", 0);
+    TEST_EQUAL("[[]]", "[[]]", 1);
+    TEST_EQUAL("[[],{}]", "[{},[]]", 0);
+    TEST_EQUAL("{}", "{}", 1);
+    TEST_EQUAL("{}", "null", 0);
+    TEST_EQUAL("{}", "[]", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2}", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":3}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2,\"c\":3}", 0);
+    /* duplicate keys pair up in order of occurrence */
+    TEST_EQUAL("{\"a\":1,\"a\":2}", "{\"a\":1,\"a\":2}", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":0,\"a\":2}", "{\"b\":0,\"a\":1,\"a\":2}", 1);
+    TEST_EQUAL("{\"a\":1,\"a\":1}", "{\"a\":1,\"a\":2}", 0);
+    TEST_EQUAL("{\"a\":1,\"a\":2}", "{\"a\":1,\"a\":1}", 0);
+    TEST_EQUAL("{\"a\":1,\"a\":1}", "{\"a\":1,\"b\":1}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":1}", "{\"a\":1,\"a\":1}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":2,\"b\":1}", 0);
+    TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":{}}}}", 1);
+    TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
+
+    /* large objects in opposite key order */
+    ason_init(&o1);
+    ason_init(&o2);
+    ason_set_object(&o1, 0);
+    ason_set_object(&o2, 0);
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "k%d", i);
+        ason_set_number(ason_set_object_value(&o1, key, strlen(key)), i);
+        sprintf(key, "k%d", 99 - i);
+        ason_set_number(ason_set_object_value(&o2, key, strlen(key)), 99 - i);
+    }
+    EXPECT_TRUE(ason_is_equal(&o1, &o2));
+    EXPECT_TRUE(ason_hash(&o1) == ason_hash(&o2));
+    ason_set_number(ason_find_object_value(&o2, "k50", 3), -1);
+    EXPECT_FALSE(ason_is_equal(&o1, &o2));
+    EXPECT_TRUE(ason_hash(&o1) != ason_hash(&o2));
+    ason_free(&o1);
+    ason_free(&o2);
+
+    /* reflexive and symmetric with duplicates in indexed objects too */
+    strcpy(json, "{");
+    for (i = 0; i < 40; i++)
+        sprintf(json + strlen(json), "%s\"k%d\":%d", i ? "," : "", i % 10, i);
+    strcat(json, "}");
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o1, json));
+    EXPECT_TRUE(ason_is_equal(&o1, &o1));
+    ason_copy(&o2, &o1);
+    EXPECT_TRUE(ason_is_equal(&o1, &o2));
+    ason_set_number(ason_get_object_value(&o2, 35), -1);
+    EXPECT_FALSE(ason_is_equal(&o1, &o2));
+    EXPECT_FALSE(ason_is_equal(&o2, &o1));
+    ason_free(&o1);
+    ason_free(&o2);
+
+    /* thousands of copies of one key pair up in linear time */
+    big = (char*)malloc(5000 * 16 + 2);
+    strcpy(big, "{");
+    for (i = 0, n = 1; i < 5000; i++)
+        n += sprintf(big + n, "%s\"a\":%d", i ? "," : "", i);
+    strcpy(big + n, "}");
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o1, big));
+    ason_copy(&o2, &o1);
+    EXPECT_TRUE(ason_is_equal(&o1, &o2));
+    ason_set_number(ason_get_object_value(&o2, 4999), -1);
+    EXPECT_FALSE(ason_is_equal(&o1, &o2));
+    EXPECT_FALSE(ason_is_equal(&o2, &o1));
+    ason_free(&o1);
+    ason_free(&o2);
+    free(big);
+
+    /* integers compare to doubles exactly, so 2^53 + 1 is equal to neither 2^53 */
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o1, "9007199254740993"));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o2, "9007199254740992.0"));
+    EXPECT_FALSE(ason_is_equal(&o1, &o2));
+    EXPECT_FALSE(ason_is_equal(&o2, &o1));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o2, "9007199254740992"));
+    EXPECT_FALSE(ason_is_equal(&o1, &o2));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o1, "9223372036854775807"));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o2, "9223372036854775808.0"));
+    EXPECT_FALSE(ason_is_equal(&o1, &o2));
+    ason_free(&o1);
+    ason_free(&o2);
+
+    /* the hash is part of the format, it must not change between releases */
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&o1, "{\"a\":[1,\"x\",null,true]}"));
+    EXPECT_TRUE((ason_hash(&o1) >> 32) == 0x3E5D6B3Fu && (ason_hash(&o1) & 0xFFFFFFFFu) == 0xA950E525u);
+    ason_free(&o1);
+}
+
+typedef struct {
+    size_t allocs, reallocs, frees;
+} test_allocator_stats;
+
+static void* test_malloc(void* user, size_t size) {
+    ((test_allocator_stats*)user)->allocs++;
+    return malloc(size);
+}
+
+static void* test_realloc(void* user, void* ptr, size_t size) {
+    if (ptr == NULL)
+        ((test_allocator_stats*)user)->allocs++;
+    else
+        ((test_allocator_stats*)user)->reallocs++;
+    return realloc(ptr, size);
+}
+
+static void test_free(void* user, void* ptr) {
+    if (ptr != NULL)
+        ((test_allocator_stats*)user)->frees++;
+    free(ptr);
+}
+
+static void test_allocator() {
+    test_allocator_stats global = { 0, 0, 0 }, local = { 0, 0, 0 };
+    ason_allocator a = { test_malloc, test_realloc, test_free, NULL };
+    ason_document* doc;
+    ason_value v;
+    char* json;
+    const char* text = "{\"a\":[1,\"a string that is not inline\"],\"b\":{\"c\":null}}";
+
+    a.user = &global;
+    ason_set_allocator(&a);
+    EXPECT_TRUE(ason_get_allocator()->user == &global);
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&v, text, strlen(text), ASON_PARSE_INTERN_KEYS));
+    ason_pushback_array_element(ason_find_object_value(&v, "a", 1));
+    json = ason_stringify(&v, NULL);
+    ason_free(&v);
+    a.free_fn(a.user, json);
+    EXPECT_TRUE(global.allocs > 0);
+    EXPECT_EQ_SIZE_T(global.allocs, global.frees);
+
+    /* a document keeps to its own allocator */
+    global.allocs = global.frees = 0;
+    a.user = &local;
+    doc = ason_document_create_ex(&a);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse_ex(doc, text, strlen(text), ASON_PARSE_INTERN_KEYS));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_document_parse(doc, text));
+    ason_document_free(doc);
+    EXPECT_EQ_SIZE_T(0, global.allocs);
+    EXPECT_TRUE(local.allocs > 0);
+    EXPECT_EQ_SIZE_T(local.allocs, local.frees);
+
+    ason_set_allocator(NULL);
+    EXPECT_TRUE(ason_get_allocator()->user == NULL);
+}
+
+static void test_parser_reuse() {
+    test_allocator_stats stats = { 0, 0, 0 };
+    ason_allocator a = { test_malloc, test_realloc, test_free, NULL };
+    ason_parser* p;
+    ason_value v, expect;
+    char* json;
+    size_t i, len, parse_allocs;
+
+    a.user = &stats;
+    ason_set_allocator(&a);
+    p = ason_parser_create();
+    json = (char*)malloc(32000);
+    for (i = 0, len = 0; i < 1000; i++)
+        len += sprintf(json + len, i ? ",[\"%04lu\",{\"k\":[]}]" : "[[\"%04lu\",{\"k\":[]}]", (unsigned long)i);
+    json[len++] = ']';
+
+    /* after the first parse, the only allocations are the value's own */
+    ason_init(&expect);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&expect, json, len));
+    for (i = 0; i < 3; i++) {
+        stats.allocs = stats.reallocs = stats.frees = 0;
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parser_parse(p, &v, json, len));
+        parse_allocs = stats.allocs;
+        EXPECT_TRUE(ason_is_equal(&expect, &v));
+        ason_free(&v);
+        if (i > 0) {
+            EXPECT_EQ_SIZE_T(0, stats.reallocs);
+            EXPECT_EQ_SIZE_T(stats.frees, parse_allocs);
+        }
+    }
+    ason_free(&expect);
+
+    EXPECT_EQ_INT(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ason_parser_parse(p, &v, json, len - 1));
+    EXPECT_EQ_INT(ASON_NULL, ason_get_type(&v));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parser_feed(p, "[1,", 3));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parser_parse(p, &v, "[2]", 3));
+    EXPECT_EQ_DOUBLE(2.0, ason_get_number(ason_get_array_element(&v, 0)));
+    ason_free(&v);
+
+    ason_parser_shrink(p);
+    stats.allocs = stats.frees = 0;
+    ason_parser_destroy(p);
+    EXPECT_EQ_SIZE_T(1, stats.frees);
+    ason_set_allocator(NULL);
+    free(json);
+}
+
+typedef struct {
+    char name[8];
+    double price;
+} test_item;
+
+typedef struct {
+    int64_t id;
+    int qty, ok;
+    double ratio;
+    char tag[6];
+    struct {
+        int x, y;
+    } pos;
+    int codes[4];
+    size_t code_count;
+    test_item items[2];
+    size_t item_count;
+} test_message;
+
+static const ason_field test_item_fields[] = {
+    { "name", ASON_FIELD_STRING, offsetof(test_item, name), sizeof(((test_item*)0)->name), NULL, 0, 0 },
+    { "price", ASON_FIELD_DOUBLE, offsetof(test_item, price), 0, NULL, 0, 0 },
+    { NULL, ASON_FIELD_BOOL, 0, 0, NULL, 0, 0 }
+};
+
+static const ason_field test_pos_fields[] = {
+    { "x", ASON_FIELD_INT, 0, 0, NULL, 0, 0 },
+    { "y", ASON_FIELD_INT, sizeof(int), 0, NULL, 0, 0 },
+    { NULL, ASON_FIELD_BOOL, 0, 0, NULL, 0, 0 }
+};
+
+static const ason_field test_int_field[] = { { NULL, ASON_FIELD_INT, 0, 0, NULL, 0, 0 } };
+static const ason_field test_item_field[] = { { NULL, ASON_FIELD_OBJECT, 0, 0, test_item_fields, 0, 0 } };
+static const ason_field test_message_fields[] = {
+    { "id", ASON_FIELD_INT64, offsetof(test_message, id), 0, NULL, 0, 0 },
+    { "qty", ASON_FIELD_INT, offsetof(test_message, qty), 0, NULL, 0, 0 },
+    { "ok", ASON_FIELD_BOOL, offsetof(test_message, ok), 0, NULL, 0, 0 },
+    { "ratio", ASON_FIELD_DOUBLE, offsetof(test_message, ratio), 0, NULL, 0, 0 },
+    { "tag", ASON_FIELD_STRING, offsetof(test_message, tag), sizeof(((test_message*)0)->tag), NULL, 0, 0 },
+    { "pos", ASON_FIELD_OBJECT, offsetof(test_message, pos), 0, test_pos_fields, 0, 0 },
+    { "codes", ASON_FIELD_ARRAY, offsetof(test_message, codes), 4, test_int_field, sizeof(int), offsetof(test_message, code_count) },
+    { "items", ASON_FIELD_ARRAY, offsetof(test_message, items), 2, test_item_field, sizeof(test_item), offsetof(test_message, item_count) },
+    { NULL, ASON_FIELD_BOOL, 0, 0, NULL, 0, 0 }
+};
+
+#define TEST_DECODE_ERROR(error, json) \
+    do {\
+        memset(&m, 0, sizeof(m));\
+        EXPECT_EQ_INT(error, ason_decode_struct(schema, json, strlen(json), &m));\
+    } while(0)
+
+static void test_decode_struct() {
+    ason_schema* schema = ason_schema_compile(test_message_fields);
+    test_message m;
+    const char* json =
+        "{ \"id\" : 9007199254740993, \"qty\": 1e2, \"ok\": true, \"ratio\": -0.5, \"tag\": \"a\\u00e9\\n\","
+        " \"skip\": [ { \"deep\": [ 1, \"x\", null ] }, 1e5 ], \"pos\": { \"y\": -2, \"z\": {}, \"x\": 7 },"
+        " \"codes\": [ 3, 1, 4 ], \"items\": [ { \"price\": 2.5, \"name\": \"pen\" }, { \"name\": null } ], \"zz\": 0 }";
+
+    memset(&m, 0, sizeof(m));
+    m.items[1].price = 9.0;
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_decode_struct(schema, json, strlen(json), &m));
+    EXPECT_TRUE(m.id == ((int64_t)1 << 53) + 1);
+    EXPECT_EQ_INT(100, m.qty);
+    EXPECT_EQ_INT(1, m.ok);
+    EXPECT_EQ_DOUBLE(-0.5, m.ratio);
+    EXPECT_EQ_STRING("a\xC3\xA9\n", m.tag, strlen(m.tag));
+    EXPECT_EQ_INT(7, m.pos.x);
+    EXPECT_EQ_INT(-2, m.pos.y);
+    EXPECT_EQ_SIZE_T(3, m.code_count);
+    EXPECT_EQ_INT(4, m.codes[2]);
+    EXPECT_EQ_SIZE_T(2, m.item_count);
+    EXPECT_EQ_STRING("pen", m.items[0].name, strlen(m.items[0].name));
+    EXPECT_EQ_DOUBLE(2.5, m.items[0].price);
+    EXPECT_EQ_DOUBLE(9.0, m.items[1].price);
+    EXPECT_EQ_SIZE_T(0, strlen(m.items[1].name));
+
+    TEST_DECODE_ERROR(ASON_PARSE_OK, "{}");
+    TEST_DECODE_ERROR(ASON_PARSE_OK, "{\"codes\":[]}");
+    TEST_DECODE_ERROR(ASON_PARSE_EXPECT_VALUE, " ");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "[]");
+    TEST_DECODE_ERROR(ASON_PARSE_ROOT_NOT_SINGULAR, "{} 1");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"id\":\"1\"}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"id\":1.5}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"id\":1e19}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"qty\":2147483648}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"ok\":1}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"tag\":\"abcdef\"}");
+    TEST_DECODE_ERROR(ASON_PARSE_OK, "{\"tag\":\"abcde\"}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"pos\":[]}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"codes\":[1,2,3,4,5]}");
+    TEST_DECODE_ERROR(ASON_PARSE_INCORRECT_TYPE, "{\"items\":[1]}");
+    /* skipped members are still checked */
+    TEST_DECODE_ERROR(ASON_PARSE_INVALID_VALUE, "{\"skip\":[tru]}");
+    TEST_DECODE_ERROR(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "{\"skip\":[1 2]}");
+    TEST_DECODE_ERROR(ASON_PARSE_MISS_KEY, "{\"id\":1,}");
+    TEST_DECODE_ERROR(ASON_PARSE_MISS_COLON, "{\"id\" 1}");
+    TEST_DECODE_ERROR(ASON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"id\":1 \"qty\":2}");
+    TEST_DECODE_ERROR(ASON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "{\"codes\":[1 2]}");
+    ason_schema_free(schema);
+}
+
+typedef struct {
+    char* s;
+    size_t len, calls;
+    int fail;
+} test_sink;
+
+static int test_sink_write(void* user, const char* s, size_t len) {
+    test_sink* k = (test_sink*)user;
+    if (k->fail)
+        return 0;
+    k->s = (char*)realloc(k->s, k->len + len + 1);
+    memcpy(k->s + k->len, s, len);
+    k->s[k->len += len] = '\0';
+    k->calls++;
+    return 1;
+}
+
+static void test_writer() {
+    test_sink k = { NULL, 0, 0, 0 };
+    ason_writer* w = ason_writer_create(test_sink_write, &k);
+    ason_value v;
+    char* big = (char*)malloc(200000), *json;
+    size_t i, len;
+
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_start_object(w));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_key(w, "a\n", 2));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_start_array(w));
+    ason_writer_int(w, -9223372036854775807 - 1);
+    ason_writer_number(w, 1.5);
+    ason_writer_null(w);
+    ason_writer_boolean(w, 0);
+    ason_writer_boolean(w, 1);
+    ason_writer_string(w, "\"\x01", 2);
+    ason_writer_start_object(w);
+    ason_writer_end_object(w);
+    ason_writer_start_array(w);
+    ason_writer_end_array(w);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_end_array(w));
+    ason_writer_key(w, "", 0);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_raw(w, "{\"r\":[0]}", 9));
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_end_object(w));
+    ason_writer_int(w, 0);
+    EXPECT_EQ_SIZE_T(0, k.len);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_finish(w));
+    EXPECT_EQ_STRING("{\"a\\n\":[-9223372036854775808,1.5,null,false,true,\"\\\"\\u0001\",{},[]],\"\":{\"r\":[0]}}\n0", k.s, k.len);
+
+    /* misuse fails and sticks until finish */
+#define TEST_WRITER_MISUSE(call) \
+    do {\
+        EXPECT_EQ_INT(ASON_PARSE_INCORRECT_TYPE, call);\
+        EXPECT_EQ_INT(ASON_PARSE_INCORRECT_TYPE, ason_writer_int(w, 1));\
+        EXPECT_EQ_INT(ASON_PARSE_INCORRECT_TYPE, ason_writer_finish(w));\
+    } while(0)
+    TEST_WRITER_MISUSE(ason_writer_key(w, "k", 1));
+    TEST_WRITER_MISUSE(ason_writer_end_array(w));
+    ason_writer_start_object(w);
+    TEST_WRITER_MISUSE(ason_writer_int(w, 1));
+    ason_writer_start_object(w);
+    TEST_WRITER_MISUSE(ason_writer_end_array(w));
+    ason_writer_start_object(w);
+    ason_writer_key(w, "k", 1);
+    TEST_WRITER_MISUSE(ason_writer_end_object(w));
+    ason_writer_start_object(w);
+    ason_writer_key(w, "k", 1);
+    TEST_WRITER_MISUSE(ason_writer_key(w, "k", 1));
+    ason_writer_start_array(w);
+    TEST_WRITER_MISUSE(ason_writer_key(w, "k", 1));
+    ason_writer_start_array(w);
+    EXPECT_EQ_INT(ASON_PARSE_INCORRECT_TYPE, ason_writer_finish(w));
+    for (i = 0; i < 1025; i++)
+        ason_writer_start_array(w);
+    EXPECT_EQ_INT(ASON_PARSE_DEPTH_EXCEEDED, ason_writer_finish(w));
+
+    /* long strings pass the buffer, escapes and all */
+    for (i = 0; i < 200000; i++)
+        big[i] = (char)(i % 5000 == 0 ? '\t' : 'a' + i % 26);
+    free(k.s);
+    k.s = NULL;
+    k.len = k.calls = 0;
+    ason_init(&v);
+    ason_set_array(&v, 0);
+    for (i = 0; i < 100; i++)
+        ason_set_string(ason_pushback_array_element(&v), big, i * 2000);
+    ason_writer_start_array(w);
+    for (i = 0; i < 100; i++)
+        ason_writer_string(w, big, i * 2000);
+    ason_writer_end_array(w);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_finish(w));
+    json = ason_stringify(&v, &len);
+    EXPECT_EQ_SIZE_T(len, k.len);
+    EXPECT_TRUE(memcmp(json, k.s, len) == 0);
+    EXPECT_TRUE(k.calls < len / 16384); /* whole buffers, not a call per piece */
+    free(json);
+    ason_free(&v);
+
+    k.fail = 1;
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_string(w, big, 10));
+    EXPECT_EQ_INT(ASON_PARSE_ABORTED, ason_writer_string(w, big, 200000));
+    EXPECT_EQ_INT(ASON_PARSE_ABORTED, ason_writer_int(w, 1));
+    EXPECT_EQ_INT(ASON_PARSE_ABORTED, ason_writer_finish(w));
+    ason_writer_destroy(w);
+    free(k.s);
+    free(big);
+
+#ifndef ASON_NO_WRITEV
+    {
+        int fds[2];
+        char buffer[64];
+        ssize_t n;
+        if (pipe(fds) == 0) {
+            w = ason_writer_create_fd(fds[1]);
+            ason_writer_start_array(w);
+            ason_writer_string(w, "fd", 2);
+            ason_writer_end_array(w);
+            EXPECT_EQ_INT(ASON_PARSE_OK, ason_writer_finish(w));
+            ason_writer_destroy(w);
+            close(fds[1]);
+            n = read(fds[0], buffer, sizeof(buffer));
+            EXPECT_EQ_STRING("[\"fd\"]", buffer, (size_t)n);
+            close(fds[0]);
+        }
+    }
+#endif
+}
+
+#define TEST_UTF8(error, json) \
+    do {\
+        ason_value v;\
+        ason_init(&v);\
+        EXPECT_EQ_INT(error, ason_validate(json, sizeof(json) - 1));\
+        EXPECT_EQ_INT(error, ason_parse_ex(&v, json, sizeof(json) - 1, ASON_PARSE_VALIDATE_UTF8));\
+        ason_free(&v);\
+        EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_n(&v, json, sizeof(json) - 1));\
+        ason_free(&v);\
+    } while(0)
+
+static void test_validate() {
+    test_allocator_stats stats = { 0, 0, 0 };
+    ason_allocator a = { test_malloc, test_realloc, test_free, NULL };
+    ason_value v;
+    char* json = (char*)malloc(1024);
+    size_t i;
+
+    TEST_UTF8(ASON_PARSE_OK, "\"\xC2\xA9\xE2\x82\xAC\xEF\xBF\xBF\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF\"");
+    TEST_UTF8(ASON_PARSE_OK, "{\"\xE2\x82\xAC\\n\xE2\x82\xAC\":[\"\xED\x9F\xBF\\\"\xEE\x80\x80\"]}");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\x80\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xC0\xAF\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xC2\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xC2\\n\xA9\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xE0\x9F\xBF\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xE2\x82\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xF0\x8F\xBF\xBF\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xF5\x80\x80\x80\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "\"\xFF\"");
+    TEST_UTF8(ASON_PARSE_INVALID_UTF8, "[\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\xE2\x82\xAC\xE2\x28\xAC\"]");
+    TEST_UTF8(ASON_PARSE_MISS_KEY, "{\"\xC0\x80\":1}");
+
+    /* digits beyond what rounding can see: just above and exactly at 2^53 + 1 */
+    memcpy(json, "9007199254740993.", 17);
+    memset(json + 17, '0', 900);
+    memcpy(json + 917, "1", 2);
+    TEST_NUMBER(9007199254740994.0, json);
+    json[917] = '\0';
+    TEST_NUMBER(9007199254740992.0, json);
+
+    a.user = &stats;
+    ason_set_allocator(&a);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_validate(json, strlen(json)));
+    for (i = 0; i < 1000; i++)
+        json[i] = i < 500 ? '[' : ']';
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_validate(json, 1000));
+    strcpy(json, "{\"a\\u00e9\": [1.5e3, \"x\\ty\", {\"b\": [null, true, false]}], \"c\": -0}");
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_validate(json, strlen(json)));
+    EXPECT_EQ_SIZE_T(0, stats.allocs);
+    EXPECT_EQ_SIZE_T(0, stats.reallocs);
+    ason_set_allocator(NULL);
+
+    ason_init(&v);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&v, json, strlen(json), ASON_PARSE_VALIDATE_UTF8));
+    ason_free(&v);
+    free(json);
+}
+
+static void test_raw_numbers() {
+    static const char* invalid[] = { "+0", ".1", "1.", "1e", "1e+", "-", "--1", "0x0", "1.e1", "INF" };
+    const char* json = "{\"big\": [12345678901234567890123, -0.100000000000000000000001, 1e400, -1E-400],"
+        " \"n\": [42, -0, 1.5, 0.1e1, -9223372036854775808]}";
+    ason_value v, w, *a;
+    ason_binary_view view;
+    char* s;
+    size_t i, len;
+
+    ason_init(&v);
+    ason_init(&w);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&v, json, strlen(json), ASON_PARSE_RAW_NUMBERS));
+    s = ason_stringify(&v, &len);
+    EXPECT_EQ_STRING("{\"big\":[12345678901234567890123,-0.100000000000000000000001,1e400,-1E-400],"
+        "\"n\":[42,-0,1.5,0.1e1,-9223372036854775808]}", s, len);
+    free(s);
+
+    a = ason_find_object_value(&v, "big", 3);
+    EXPECT_EQ_DOUBLE(1.2345678901234568e22, ason_get_number(ason_get_array_element(a, 0)));
+    EXPECT_FALSE(ason_is_integer(ason_get_array_element(a, 0)));
+    EXPECT_EQ_DOUBLE(-0.1, ason_get_number(ason_get_array_element(a, 1)));
+    EXPECT_TRUE(ason_get_number(ason_get_array_element(a, 2)) > 1.7976931348623157e308);
+    EXPECT_EQ_DOUBLE(0.0, ason_get_number(ason_get_array_element(a, 3)));
+    s = (char*)ason_get_number_text(ason_get_array_element(a, 2), &len);
+    EXPECT_EQ_STRING("1e400", s, len);
+    a = ason_find_object_value(&v, "n", 1);
+    EXPECT_TRUE(ason_is_integer(ason_get_array_element(a, 0)));
+    EXPECT_TRUE(ason_get_integer(ason_get_array_element(a, 0)) == 42);
+    EXPECT_FALSE(ason_is_integer(ason_get_array_element(a, 1)));
+    EXPECT_EQ_DOUBLE(1.5, ason_get_number(ason_get_array_element(a, 2)));
+    EXPECT_TRUE(ason_get_integer(ason_get_array_element(a, 4)) == -9223372036854775807 - 1);
+    ason_set_integer(ason_get_array_element(a, 2), 7);
+    EXPECT_TRUE(ason_get_number_text(ason_get_array_element(a, 2), NULL) == NULL);
+
+    /* raw numbers compare and hash by value */
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse(&w, "[42.0,0,7,1,-9223372036854775808]"));
+    EXPECT_TRUE(ason_is_equal(a, &w));
+    EXPECT_TRUE(ason_hash(a) == ason_hash(&w));
+    ason_free(&w);
+    ason_copy(&w, a);
+    EXPECT_TRUE(ason_is_equal(a, &w));
+    ason_free(&w);
+    s = ason_encode_binary(a, &len);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_binary_open(&view, s, len));
+    ason_binary_to_value(&view, &w);
+    EXPECT_TRUE(ason_is_equal(a, &w));
+    free(s);
+    ason_free(&w);
+    ason_free(&v);
+
+    /* a copy owns its text and outlives the input */
+    s = (char*)malloc(strlen(json) + 1);
+    strcpy(s, json);
+    EXPECT_EQ_INT(ASON_PARSE_OK, ason_parse_ex(&v, s, strlen(s), ASON_PARSE_RAW_NUMBERS));
+    ason_copy(&w, &v);
+    ason_free(&v);
+    memset(s, 'x', strlen(json));
+    free(s);
+    a = ason_find_object_value(&w, "big", 3);
+    s = (char*)ason_get_number_text(ason_get_array_element(a, 1), &len);
+    EXPECT_EQ_STRING("-0.100000000000000000000001", s, len);
+    EXPECT_EQ_DOUBLE(-0.1, ason_get_number(ason_get_array_element(a, 1)));
+    s = ason_stringify(&w, &len);
+    EXPECT_EQ_STRING("{\"big\":[12345678901234567890123,-0.100000000000000000000001,1e400,-1E-400],"
+        "\"n\":[42,-0,1.5,0.1e1,-9223372036854775808]}", s, len);
+    free(s);
+    ason_set_integer(ason_get_array_element(a, 0), 1);
+    ason_free(&w);
+
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        EXPECT_EQ_INT(ason_parse(&v, invalid[i]), ason_parse_ex(&w, invalid[i], strlen(invalid[i]), ASON_PARSE_RAW_NUMBERS));
+        ason_free(&v);
+        ason_free(&w);
+    }
 }
 
 int main() {
     test_parse();
+    test_stringify();
     test_access();
+    test_document();
+    test_parse_insitu();
+    test_ondemand();
+    test_path();
+    test_binary();
+    test_copy();
+    test_equal();
+    test_allocator();
+    test_parser_reuse();
+    test_decode_struct();
+    test_writer();
+    test_validate();
+    test_raw_numbers();
     printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
     return main_ret;
 }